@@ -72,6 +72,96 @@ static struct cag_option options[] = {
      .value_name = NULL,
      .description = "Do not print list of directories or header information."},
 
+    {.identifier = 'r',
+     .access_letters = "r",
+     .access_name = "recursive",
+     .value_name = NULL,
+     .description = "Recurse down directories and include aggregated results."},
+
+    {.identifier = 'j',
+     .access_letters = "j",
+     .access_name = "jobs",
+     .value_name = "N",
+     .description = "Scan with N threads (0 for one per CPU)."},
+
+    {.identifier = 'D',
+     .access_letters = NULL,
+     .access_name = "per-device-jobs",
+     .value_name = "N",
+     .description = "Scan each device with N threads (overrides -j)."},
+
+    {.identifier = 'U',
+     .access_letters = NULL,
+     .access_name = "unique-inodes",
+     .value_name = NULL,
+     .description = "Count hard-linked or bind-mounted objects only once."},
+
+    {.identifier = 'R',
+     .access_letters = NULL,
+     .access_name = "resolve-unknown",
+     .value_name = NULL,
+     .description = "Stat entries of unknown type (no d_type) to count them."},
+
+    {.identifier = 'z',
+     .access_letters = NULL,
+     .access_name = "sizes",
+     .value_name = NULL,
+     .description = "Total apparent and allocated bytes by type."},
+
+    {.identifier = 'A',
+     .access_letters = NULL,
+     .access_name = "ages",
+     .value_name = NULL,
+     .description = "Count entries and bytes by time since last modified."},
+
+    {.identifier = 'Q',
+     .access_letters = NULL,
+     .access_name = "stat-queue",
+     .value_name = "N",
+     .description = "Keep N io_uring lookups in flight (Linux; 0 for none)."},
+
+    {.identifier = 'P',
+     .access_letters = NULL,
+     .access_name = "per-dir",
+     .value_name = NULL,
+     .description = "Stream a row of counts for each directory as it is read."},
+
+    {.identifier = 'T',
+     .access_letters = NULL,
+     .access_name = "top",
+     .value_name = "N",
+     .description = "List the N directories holding the most entries."},
+
+    {.identifier = 'H',
+     .access_letters = NULL,
+     .access_name = "histogram",
+     .value_name = NULL,
+     .description = "Histogram directories by their number of entries."},
+
+    {.identifier = 'e',
+     .access_letters = NULL,
+     .access_name = "histogram-depth",
+     .value_name = NULL,
+     .description = "Histogram by depth as well (implies --histogram)."},
+
+    {.identifier = 'B',
+     .access_letters = NULL,
+     .access_name = "dirent-buffer",
+     .value_name = "SIZE",
+     .description = "getdents64() buffer size, e.g. 4M (Linux; 0: readdir)."},
+
+    {.identifier = 'S',
+     .access_letters = NULL,
+     .access_name = "stats",
+     .value_name = NULL,
+     .description = "Print scan statistics to STDERR on completion."},
+
+    {.identifier = 'F',
+     .access_letters = NULL,
+     .access_name = "from-file",
+     .value_name = "FILE",
+     .description = "Read further directories from FILE (- for STDIN)."},
+
     {.identifier = 'o',
      .access_letters = "o",
      .access_name = "output",
@@ -108,10 +198,11 @@ struct sel_opts_s opt = {
     // Default values for sel_opts{}.
     .upd = false, .lin = false, .csv = false,
     .qit = false, .out = false, .log = false,
-    .outfile = "", .logfile = "",
+    .rec = false, .sts = false, .uniq = false, .unk = false, .size = false,
+    .sq = STAT_QUEUE_DFLT, .dbuf = DENT_BUF_DFLT, .jobs = 0, .pdj = 0,
+    .from = NULL, .outfile = "", .logfile = "",
     .OUTFILE = NULL, .LOGFILE = NULL,
     .FILEOPTS =  "a", // O_WRONLY | O_CREAT | O_APPEND
-    .list = {}
 };
 
 /**
@@ -120,24 +211,309 @@ struct sel_opts_s opt = {
  */
 struct dir_ent_s de = {
     // Default values for dir_ent_s{}.
-    .d_fif = 0, .d_chr = 0, .d_dir = 0,
-    .d_blk = 0, .d_reg = 0, .d_lnk = 0,
-    .d_sok = 0, .d_wht = 0, .d_unk = 0,
-    .num_hdr = 0,
+    .counts = {0},
+    .num_hdr = 0, .num_col = 0, .col_w = 8, .num_dir = 0,
     .fqdp = NULL
 };
 
 /**
- * Function to write to output opt.outfile if specified.
+ * Statistics about the scan itself, for `--stats`.
+ */
+struct scan_sts_s ss = {
+    .ents = 0, .dirs = 0, .reads = 0
+};
+
+/**
+ * Per-thread `getdents64()` buffer of `opt.dbuf` bytes, allocated in `main()`
+ * and by each pool worker.
+ */
+_Thread_local char *dent_buf = NULL;
+
+/**
+ * The `d_type` bytes gathered from one fill of `dent_buf`, laid end to end
+ * for the histogram kernel. Holds `opt.dbuf / DENT_REC_MIN` entries.
+ */
+_Thread_local unsigned char *dent_types = NULL;
+
+/**
+ * The `-j` thread pool, and the worker (if any) running on this thread.
+ */
+struct pool_s pool = {
+    .w = NULL, .num = 0, .g = NULL, .num_g = 0,
+    .pending = 0, .queued = 0, .fd_max = 0,
+    .lock = PTHREAD_MUTEX_INITIALIZER
+};
+_Thread_local worker_s *self = NULL;
+
+/**
+ * The main thread's tally, and the tally belonging to the running thread.
+ */
+tally_s main_tally;
+_Thread_local tally_s *tally = &main_tally;
+
+/**
+ * The root whose tree the running thread is currently reading.
+ */
+_Thread_local dir_node_s *cur_root = NULL;
+
+/**
+ * How far below its root the directory being read lies, for `--per-dir`.
+ */
+_Thread_local int cur_depth = 0;
+
+/**
+ * The time `--ages` are measured back from: when the scan started.
+ */
+time_t age_now = 0;
+
+/**
+ * The main thread's `--top` list, and the list belonging to the running
+ * thread.
+ */
+top_s main_top;
+_Thread_local top_s *top = &main_top;
+
+/**
+ * The `--unique-inodes` set, and the device this thread last looked up in it.
+ */
+struct ino_set_s inos = {
+    .num_devs = 0, .dups = 0,
+    .lock = PTHREAD_MUTEX_INITIALIZER
+};
+_Thread_local dev_t last_dev = 0;
+_Thread_local int   last_di  = -1;
+
+/**
+ * The main thread's arena, and the arena belonging to the running thread.
+ */
+arena_s main_arena;
+_Thread_local arena_s *arena = &main_arena;
+
+/**
+ * The running thread's io_uring for `statBatch()`, set up on first use, and
+ * why the first one that could not be set up failed.
+ */
+#ifdef HAVE_URING
+_Thread_local uring_s ring = {.fd = -1, .depth = 0};
+#endif
+int uring_err = 0;
+
+/**
+ * The output buffer shared by every formatter.
+ */
+struct out_buf_s out = {
+    .buf = NULL, .len = 0, .cap = 0
+};
+
+/**
+ * The running thread's `--per-dir` row buffer, and the lock that keeps whole
+ * buffers from interleaving as they are written out.
+ */
+_Thread_local char  *row_buf = NULL;
+_Thread_local size_t row_len = 0, row_cap = 0;
+pthread_mutex_t row_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * The histogram kernel in use and its name for `--stats`; see `pickHist()`.
+ */
+hist_fn     histTypes = histScalar;
+const char *hist_name = "scalar";
+
+/**
+ * Append `printf()`-style output to the output buffer, doubling it whenever
+ * it runs out of room.
+ */
+void putOut(const char *fmt, ...)
+{
+    va_list ap;
+    int     n = 0;
+
+    for ( ;; ) {
+        if ( ! out.buf ) {
+            out.cap = OUT_BUF_MIN;
+            out.buf = malloc(out.cap);
+            if ( ! out.buf ) logError(true, "unable to allocate output buffer");
+        }
+
+        va_start(ap, fmt);
+        n = vsnprintf(out.buf + out.len, out.cap - out.len, fmt, ap);
+        va_end(ap);
+
+        if ( n < 0 ) logError(true, "unable to format output");
+        if ( (size_t)n < out.cap - out.len ) break;
+
+        /// Truncated: grow to fit and format it again.
+        while ( out.cap - out.len <= (size_t)n ) out.cap *= 2;
+        out.buf = realloc(out.buf, out.cap);
+        if ( ! out.buf ) logError(true, "unable to allocate output buffer");
+    }
+
+    out.len += n;
+}
+
+/**
+ * Flush the output buffer to `-o OUTFILE` (`wrt`) or to `STDOUT` (`prt`)
+ * with a single `write()`, only looping if the kernel takes less than all of
+ * it, and empty it for reuse.
+ */
+void writeOut(enum action act)
+{
+    FILE *fp = ( act == wrt ) ? opt.OUTFILE : stdout;
+
+    fflush(fp); /// Anything already printed through `stdio` goes first.
+    writeAll(fileno(fp), out.buf, out.len,
+             ( act == wrt ) ? opt.outfile : "STDOUT");
+
+    out.len = 0;
+}
+
+/**
+ * Write all `len` bytes of `buf` to `fd`, looping only if the kernel takes
+ * less than all of them. Failure is fatal, reported against `what`.
+ */
+void writeAll(int fd, const char *buf, size_t len, char *what)
+{
+    size_t off = 0;
+    ssize_t  n = 0;
+
+    while ( off < len ) {
+        n = write(fd, buf + off, len - off);
+        if ( n < 0 ) {
+            if ( errno == EINTR ) continue;
+            Dprint("failed writing to fd %d...", fd);
+            logError(true, what);
+        }
+        off += n;
+    }
+}
+
+/**
+ * Print the `--per-dir` column headings to `-o OUTFILE` (`wrt`) or to
+ * `STDOUT` (`prt`): the depth, each type's count and, with `--sizes`, the
+ * directory's apparent and allocated bytes, then the path. CSV puts the
+ * path first, as the other CSV output does its directory list.
+ */
+void rowHeader(enum action act)
+{
+    int i = 0;
+
+    if ( opt.csv ) {
+        putOut("Path,Depth");
+        for ( i = 0 ; i < de.num_hdr ; ++i ) putOut(",%s", DT_TYPES[i].csv);
+        if ( opt.size ) putOut(",Bytes,Allocated");
+    } else {
+        putOut("Depth");
+        for ( i = 0 ; i < de.num_hdr ; ++i ) putOut("\t%s", DT_TYPES[i].hdr);
+        if ( opt.size ) putOut("\t%s\t%s", SIZE_HDR[0], SIZE_HDR[1]);
+        putOut("\tPath");
+    }
+    putOut("\n");
+
+    writeOut(act);
+}
+
+/**
+ * Format the `--per-dir` row for the directory at `path`, from its
+ * `counts[]` and, with `--sizes`, the totals in `sz`, into the running
+ * thread's row buffer. The buffer is written out whole, first, whenever the
+ * row might not fit, so each thread holds at most `ROW_BUF` bytes of rows
+ * (or one row, were a path longer) however many directories it reads.
+ *
+ * Plain rows are tab-separated, with the path last so that it may hold
+ * anything but a newline. CSV rows quote a path that needs it.
+ */
+void putRow(char *path, uint64_t *counts, sizes_s *sz)
+{
+    uint64_t values[DT_SLOTS];
+    uint64_t bytes = 0, alloc = 0;
+    size_t    plen = strlen(path);
+    size_t    need = 2 * plen + 24 * (de.num_col + 2);
+    char        *p = NULL;
+    int          i = 0;
+
+    if ( row_len + need > row_cap ) {
+        flushRows();
+        if ( need > row_cap ) {
+            row_cap = need > ROW_BUF ? need : ROW_BUF;
+            free(row_buf);
+            row_buf = malloc(row_cap);
+            if ( ! row_buf ) logError(true, "unable to allocate row buffer");
+        }
+    }
+
+    foldSlots(counts, values);
+    for ( i = 0 ; opt.size && i < DT_SLOTS ; ++i ) {
+        bytes += sz->bytes[i];
+        alloc += sz->alloc[i];
+    }
+
+    p = row_buf + row_len;
+    if ( opt.csv ) {
+        p += csvPath(p, path);
+        p += sprintf(p, ",%d", cur_depth);
+        for ( i = 0 ; i < de.num_hdr ; ++i ) {
+            p += sprintf(p, ",%" PRIu64, values[i]);
+        }
+        if ( opt.size ) {
+            p += sprintf(p, ",%" PRIu64 ",%" PRIu64, bytes, alloc);
+        }
+    } else {
+        p += sprintf(p, "%d", cur_depth);
+        for ( i = 0 ; i < de.num_hdr ; ++i ) {
+            p += sprintf(p, "\t%" PRIu64, values[i]);
+        }
+        if ( opt.size ) {
+            p += sprintf(p, "\t%" PRIu64 "\t%" PRIu64, bytes, alloc);
+        }
+        *p++ = '\t';
+        memcpy(p, path, plen);
+        p += plen;
+    }
+    *p++ = '\n';
+
+    row_len = p - row_buf;
+}
+
+/**
+ * Write `path` to `dst`, which must have room for twice its length plus
+ * three, as a CSV field: in double quotes, with any inside doubled, if it
+ * holds a comma, a quote or a line break, and otherwise as it is. Returns
+ * the number of bytes written, not counting the NUL.
+ */
+size_t csvPath(char *dst, const char *path)
+{
+    char *p = dst;
+
+    if ( ! strpbrk(path, ",\"\r\n") ) return stpcpy(dst, path) - dst;
+
+    *p++ = '"';
+    for ( ; *path ; ++path ) {
+        if ( *path == '"' ) *p++ = '"';
+        *p++ = *path;
+    }
+    *p++ = '"';
+    *p   = '\0';
+
+    return p - dst;
+}
+
+/**
+ * Write the running thread's `--per-dir` rows to `STDOUT` and, with `-o`,
+ * to `OUTFILE`, and empty its buffer. Rows go straight to the descriptors,
+ * bypassing `stdio`, under `row_lock`, so that each buffer lands whole.
  */
-void writeOut(char *msg)
+void flushRows()
 {
-    int tmp = fprintf(opt.OUTFILE, msg, sizeof(msg));
+    if ( ! row_len ) return;
 
-    if ( tmp < 1 ) {
-        Dprint("failed writing to %s...", opt.outfile);
-        logError(true, opt.outfile);
+    pthread_mutex_lock(&row_lock);
+    writeAll(STDOUT_FILENO, row_buf, row_len, "STDOUT");
+    if ( opt.out ) {
+        writeAll(fileno(opt.OUTFILE), row_buf, row_len, opt.outfile);
     }
+    pthread_mutex_unlock(&row_lock);
+
+    row_len = 0;
 }
 
 /**
@@ -154,255 +530,2414 @@ void logError(bool fail, char *msg)
     asprintf(&msg_buffer, "%s: %s\n", msg_buffer, strerror(errno));
 
     if ( opt.log ) {
-        int tmp = fprintf(opt.LOGFILE, msg_buffer, sizeof(msg_buffer) < 1);
-        if ( tmp < 1 ) {
+        /// Never as the format: it holds paths and entry names.
+        if ( fputs(msg_buffer, opt.LOGFILE) == EOF ) {
             perror(opt.logfile);
             free(msg_buffer);
             exit(EXIT_FAILURE);
         }
-    }
+    }
+
+    if ( fail || ! opt.log ) {
+        Dprint("%s", msg_buffer);
+        printf("%s", msg_buffer);
+        free(msg_buffer);
+        exit(errno);
+    }
+}
+
+/**
+ * Start a new chunk of arena `a` with room for at least `n` bytes, reusing
+ * the spare chunk if it is big enough.
+ */
+static arena_chunk_s *arenaChunk(arena_s *a, size_t n)
+{
+    arena_chunk_s *c = NULL;
+
+    if ( n < ARENA_CHUNK ) n = ARENA_CHUNK;
+
+    if ( a->spare && a->spare->size >= n ) {
+        c = a->spare;
+        a->spare = NULL;
+    } else {
+        c = malloc(sizeof(arena_chunk_s) + n);
+        if ( ! c ) logError(true, "unable to allocate arena");
+        c->size = n;
+        ++(a->chunks);
+    }
+
+    c->used = 0;
+    c->prev = a->head;
+    a->head = c;
+    return c;
+}
+
+/**
+ * Carve `n` bytes aligned to `align`, a power of two, out of arena `a`,
+ * starting a new chunk if the current one is too full.
+ */
+void *arenaAlloc(arena_s *a, size_t n, size_t align)
+{
+    arena_chunk_s *c = a->head;
+    uintptr_t      p = 0;
+
+    if ( c ) p = ( (uintptr_t)c->data + c->used + align - 1 ) & -align;
+    if ( ! c || p + n > (uintptr_t)c->data + c->size ) {
+        c = arenaChunk(a, n + align);
+        p = ( (uintptr_t)c->data + align - 1 ) & -align;
+    }
+
+    a->bytes += p + n - ( (uintptr_t)c->data + c->used );
+    c->used   = p + n - (uintptr_t)c->data;
+    if ( a->bytes > a->peak ) a->peak = a->bytes;
+    ++(a->allocs);
+
+    return (void *)p;
+}
+
+/**
+ * Resize `p`, of `old` bytes, to `n` bytes. The last thing carved out of a
+ * chunk grows in place while there is room; anything else is copied.
+ */
+void *arenaGrow(arena_s *a, void *p, size_t old, size_t n)
+{
+    arena_chunk_s *c = a->head;
+    void          *q = NULL;
+
+    if ( p && c && (char *)p + old == c->data + c->used
+         && (char *)p + n <= c->data + c->size ) {
+        c->used  += n - old;
+        a->bytes += n - old;
+        if ( a->bytes > a->peak ) a->peak = a->bytes;
+        return p;
+    }
+
+    q = arenaAlloc(a, n, 1);
+    if ( p ) memcpy(q, p, old);
+    return q;
+}
+
+/**
+ * Copy string `s` into arena `a`.
+ */
+char *arenaStrdup(arena_s *a, const char *s)
+{
+    size_t len = strlen(s) + 1;
+
+    return memcpy(arenaAlloc(a, len, 1), s, len);
+}
+
+/**
+ * Note the current top of arena `a`, to roll back to with `arenaRelease()`.
+ */
+arena_mark_s arenaMark(arena_s *a)
+{
+    arena_mark_s m = {a->head, a->head ? a->head->used : 0, a->bytes};
+
+    return m;
+}
+
+/**
+ * Hand back everything carved out of arena `a` since mark `m`. Chunks
+ * started since are freed, bar the largest, which is kept as the spare so
+ * that a thread working back and forth over a chunk boundary does not call
+ * `malloc()` each time.
+ */
+void arenaRelease(arena_s *a, arena_mark_s m)
+{
+    arena_chunk_s *c = NULL;
+
+    while ( a->head != m.chunk ) {
+        c = a->head;
+        a->head = c->prev;
+        if ( ! a->spare || c->size > a->spare->size ) {
+            free(a->spare);
+            a->spare = c;
+        } else {
+            free(c);
+        }
+    }
+
+    if ( a->head ) a->head->used = m.used;
+    a->bytes = m.bytes;
+}
+
+/**
+ * Free every chunk of arena `a` in one go. Its statistics are kept for
+ * `--stats`.
+ */
+void arenaFree(arena_s *a)
+{
+    arenaRelease(a, (arena_mark_s){NULL, 0, 0});
+    free(a->spare);
+    a->spare = NULL;
+}
+
+/**
+ * Initialise the root table with room for `cap` roots. The table is never
+ * grown, so pointers to its roots stay good for the whole run.
+ */
+dir_list_s *createDirList(uint64_t cap)
+{
+    dir_list_s *dir_path = arenaAlloc(arena, sizeof(dir_list_s),
+                                      _Alignof(dir_list_s));
+
+    dir_path->root = arenaAlloc(arena, cap * sizeof(dir_node_s), CACHE_LINE);
+    dir_path->num_dirs = 0;
+    dir_path->cap = cap;
+    Dprint("initialised %s for %" PRIu64, "dir_path", cap);
+    return dir_path;
+}
+
+/**
+ * Initialise the next root in the table for storing directory paths.
+ */
+dir_node_s *createDirNode(dir_list_s *paths, dp_name *dir)
+{
+    dir_node_s *new_ent = NULL;
+
+    if ( paths->num_dirs == paths->cap ) {
+        errno = EOVERFLOW;
+        logError(true, "directory table full");
+    }
+
+    new_ent = &paths->root[paths->num_dirs++];
+    memset(new_ent, 0, sizeof(dir_node_s));
+    new_ent->dir = dir;
+    Dprint("%s", dir);
+    return new_ent;
+}
+
+/**
+ * Check roots in the table for uniqueness. Each directory is keyed on its
+ * (device, inode) pair, which catches the same path given twice as well as
+ * one reached through a symlink or bind mount, in an open-addressing table
+ * sized to twice the number of roots, so the check stays linear however
+ * many there are.
+ */
+void checkUniqueDirs(dir_list_s *dir_list)
+{
+    dir_node_s  *cursor = dir_list->root;
+    dir_node_s **seen   = NULL;
+    char          *msg  = NULL;
+    arena_mark_s  mark  = arenaMark(arena);
+    size_t  cap = 2, i = 0;
+
+    while ( cap < dir_list->num_dirs * 2 ) cap *= 2;
+
+    seen = arenaAlloc(arena, cap * sizeof(*seen), _Alignof(dir_node_s *));
+    memset(seen, 0, cap * sizeof(*seen));
+
+    for ( ; cursor < dir_list->root + dir_list->num_dirs ; ++cursor ) {
+        if ( cursor->from ) continue;
+
+        /// The low bits of the device number are plenty to spread on.
+        i = inoHash((uint16_t)cursor->dev, (uint64_t)cursor->ino) & (cap - 1);
+
+        for ( ; seen[i] ; i = (i + 1) & (cap - 1) ) {
+            if ( seen[i]->ino == cursor->ino && seen[i]->dev == cursor->dev ) {
+                asprintf(&msg, "%s: directory not unique", cursor->dir);
+                Dprint("%s==%s: %s", seen[i]->dir, cursor->dir, msg);
+                errno = EEXIST;
+                logError(true, msg);
+            }
+        }
+
+        seen[i] = cursor;
+    }
+
+    arenaRelease(arena, mark);
+}
+
+/**
+ * Find the child `name` (`len` bytes) of trie node `parent`, adding it if
+ * `add` is set. Returns 0, which is never anybody's child, if there is none.
+ */
+uint32_t trieStep(trie_s *t, uint32_t parent, const char *name, uint32_t len,
+                  bool add)
+{
+    uint64_t     h = 0xcbf29ce484222325ULL ^ parent; /// FNV-1a
+    trie_node_s *n = NULL;
+    size_t       i = 0;
+
+    for ( i = 0 ; i < len ; ++i ) {
+        h ^= (unsigned char)name[i];
+        h *= 0x100000001b3ULL;
+    }
+
+    for ( i = h & (t->cap - 1) ; t->slot[i] ; i = (i + 1) & (t->cap - 1) ) {
+        n = &t->node[t->slot[i]];
+        if ( n->parent == parent && n->len == len
+             && memcmp(n->name, name, len) == 0 ) {
+            return t->slot[i];
+        }
+    }
+
+    if ( ! add ) return 0;
+
+    t->node[t->num] = (trie_node_s){parent, len, name, NULL};
+    t->slot[i] = t->num;
+    return t->num++;
+}
+
+/**
+ * With `-r`, a root inside another root would have its tree counted twice.
+ * Every root path is added to a prefix trie, one node per component, and
+ * then walked again: the first node on the way down that ends another root
+ * marks the outermost root holding this one. Such roots are kept in the list
+ * but not scanned. Both passes cost time in proportion to the total length
+ * of the paths.
+ */
+void checkNestedDirs(dir_list_s *dir_list)
+{
+    dir_node_s *cursor = NULL;
+    trie_s           t = {NULL, 0, NULL, 2};
+    arena_mark_s  mark = arenaMark(arena);
+    size_t       comps = 1;
+    uint32_t         n = 0;
+    const char   *p, *q;
+
+    /// Each '/' starts at most one component.
+    for ( cursor = dir_list->root ;
+          cursor < dir_list->root + dir_list->num_dirs ; ++cursor ) {
+        for ( p = cursor->dir ; *p ; ++p ) comps += ( *p == '/' );
+    }
+    while ( t.cap < comps * 2 ) t.cap *= 2;
+
+    t.node = arenaAlloc(arena, comps * sizeof(*t.node), _Alignof(trie_node_s));
+    t.slot = arenaAlloc(arena, t.cap * sizeof(*t.slot), _Alignof(uint32_t));
+    memset(t.slot, 0, t.cap * sizeof(*t.slot));
+    t.node[t.num++] = (trie_node_s){0, 0, "", NULL};
+
+    for ( cursor = dir_list->root ;
+          cursor < dir_list->root + dir_list->num_dirs ; ++cursor ) {
+        if ( cursor->from ) continue;
+        for ( n = 0, p = cursor->dir ; *p ; p = q ) {
+            while ( *p == '/' ) ++p;
+            for ( q = p ; *q && *q != '/' ; ++q ) ;
+            if ( q > p ) n = trieStep(&t, n, p, q - p, true);
+        }
+        t.node[n].root = cursor;
+    }
+
+    for ( cursor = dir_list->root ;
+          cursor < dir_list->root + dir_list->num_dirs ; ++cursor ) {
+        if ( cursor->from ) continue;
+        for ( n = 0, p = cursor->dir ; *p ; p = q ) {
+            if ( t.node[n].root && t.node[n].root != cursor ) {
+                cursor->outer = t.node[n].root;
+                Dprint("%s: inside %s", cursor->dir, cursor->outer->dir);
+                break;
+            }
+            while ( *p == '/' ) ++p;
+            for ( q = p ; *q && *q != '/' ; ++q ) ;
+            if ( q > p ) n = trieStep(&t, n, p, q - p, false);
+        }
+    }
+
+    arenaRelease(arena, mark);
+}
+
+/**
+ * Open directory `path` for reading a root, without touching its access
+ * time where the platform and our permissions allow.
+ */
+int openDir(const char *path)
+{
+    int err = errno;
+    int  fd = open(path, O_RDONLY | O_DIRECTORY | O_NOATIME | O_CLOEXEC);
+
+    /// Only the owner, or root, may use `O_NOATIME`. The refusal is no
+    /// error of the scan's, so it must not reach the exit status.
+    if ( fd < 0 && errno == EPERM && O_NOATIME ) {
+        fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if ( fd >= 0 ) errno = err;
+    }
+
+    return fd;
+}
+
+/**
+ * Test directory, identified by pointer to const char, prior to further action.
+ */
+bool testDir(char *dir)
+{
+    struct stat sb;
+    char fq[MAXPATHLEN];
+    bool ok = false;
+    int err = errno;
+
+    /// Canonicalise the path, relative or not, without touching the working
+    /// directory, which every thread shares. With `.`, `..` and symlinks
+    /// resolved, the same directory always has the same path, which is what
+    /// `checkNestedDirs()` relies on.
+    if ( ! realpath(dir, fq) ) {
+        Dprint("%s: %s", dir, "FALSE");
+        return false;
+    }
+
+    /// glibc probes every component with `readlink()`, leaving `EINVAL`
+    /// behind even when it succeeds.
+    errno = err;
+
+    /// Open the root here, once, and validate it through the descriptor:
+    /// every later scan of it rewinds this rather than looking the path up
+    /// again, which on NFS is a round trip each time. Past `de.fd_max`
+    /// roots, the path is checked and left for `openRoot()` to open.
+    de.fqfd = -1;
+    if ( de.num_fd < de.fd_max ) {
+        de.fqfd = openDir(fq);
+        if ( de.fqfd < 0 && errno != EMFILE && errno != ENFILE ) {
+            Dprint("%s: %s", dir, "FALSE");
+            return false;
+        }
+    }
+
+    if ( de.fqfd >= 0 ) {
+        ok = fstat(de.fqfd, &sb) == 0;
+        ++de.num_fd;
+    } else {
+        ok = stat(fq, &sb) == 0 && S_ISDIR(sb.st_mode);
+    }
+
+    if ( ok ) {
+        /// Push the fully-qualified directory path to a holding element to
+        /// be added to the root table.
+        de.fqdp = arenaStrdup(arena, fq);
+        Dprint("FQP: %s", de.fqdp);
+        de.fqdev = sb.st_dev;
+        de.fqino = sb.st_ino;
+
+        ++de.num_dir;
+        Dprint("%s %" PRIu64, "TRUE", de.num_dir);
+        return true;
+    }
+
+    /// If neither of the above conditions holds, `*dir` is not a valid
+    /// directory path.
+    if ( de.fqfd >= 0 ) {
+        (void)close(de.fqfd);
+        --de.num_fd;
+    }
+    Dprint("%s: %s", dir, "FALSE");
+    return false;
+}
+
+/**
+ * Add a directory entry to the root table.
+ */
+void addDir(dir_list_s *paths, char *path_arg)
+{
+    dir_node_s *dir_node = NULL;
+
+    if ( testDir(path_arg) ) {
+        Dprint("%s", "testDir returned TRUE to addDir");
+        dir_node = createDirNode(paths, de.fqdp);
+        dir_node->dev = de.fqdev;
+        dir_node->ino = de.fqino;
+        dir_node->fd  = de.fqfd;
+        Dprint("addDir %s", dir_node->dir);
+        Dprint("num_dirs: %" PRIu64, paths->num_dirs);
+    } else {
+        if ( errno == 0 ) errno = ENOENT;
+        logError(false, path_arg);
+    }
+}
+
+/**
+ * Add the `--from-file` list `file` to the root table as a root of its own,
+ * which stands for every root read from it: they share its totals and are
+ * neither kept nor checked against the other roots, so memory does not grow
+ * with the length of the list.
+ */
+void addList(dir_list_s *paths, char *file)
+{
+    dir_node_s *node = NULL;
+    char       *name = arenaAlloc(arena, strlen(file) + 8, 1);
+    FILE         *fp = strcmp(file, "-") == 0 ? stdin : fopen(file, "r");
+
+    if ( ! fp ) {
+        Dprint("NULL FILE *: %s", file);
+        logError(true, file);
+    }
+
+    sprintf(name, "%s (list)", fp == stdin ? "STDIN" : file);
+    node = createDirNode(paths, name);
+    node->from = fp;
+    node->fd   = -1;
+    ++de.num_dir;
+}
+
+/**
+ * Read the next path from a `--from-file` list into `*buf`, returning NULL
+ * at the end. Whichever of newline or NUL ends the first path, recorded in
+ * `*sep`, separates the rest, so NUL-separated lists may hold names with
+ * newlines in them. Empty paths are skipped.
+ */
+char *nextRoot(FILE *fp, char **buf, size_t *cap, int *sep)
+{
+    size_t len = 0;
+    int      c = 0;
+
+    for ( ;; ) {
+        c = getc_unlocked(fp);
+
+        if ( c == EOF || c == *sep
+             || ( *sep < 0 && ( c == '\n' || c == '\0' ) ) ) {
+            if ( c != EOF && *sep < 0 ) *sep = c;
+            if ( len > 0 ) break;
+            if ( c == EOF ) return NULL;
+            continue;
+        }
+
+        if ( len + 2 > *cap ) {
+            *cap = *cap ? *cap * 2 : MAXPATHLEN;
+            *buf = realloc(*buf, *cap);
+            if ( ! *buf ) logError(true, "unable to allocate path buffer");
+        }
+        (*buf)[len++] = (char)c;
+    }
+
+    (*buf)[len] = '\0';
+    return *buf;
+}
+
+/**
+ * Scan each root read from `--from-file` node `list` as it arrives. Once the
+ * pool is running, each is dealt to the next worker of the group for its
+ * device (or of the list's own group), so scanning begins with the first
+ * line; while the pool already holds as many descriptors as it may, and
+ * without a pool at all, it is read inline instead. Every root counts
+ * towards the list's totals.
+ */
+void scanList(dir_node_s *list)
+{
+    struct stat sb;
+    group_s    *g = NULL;
+    char     *buf = NULL, *path = NULL;
+    char      fq[MAXPATHLEN];
+    size_t    cap = 0;
+    int       sep = -1, fd = -1, err = 0;
+
+    while ( ( path = nextRoot(list->from, &buf, &cap, &sep) ) ) {
+        /// Where the path is printed, canonicalise it as `testDir()` does
+        /// the other roots, so that output names it the same way whichever
+        /// way it was listed. Otherwise spare the look-up of every component
+        /// that `realpath()` costs, which adds up over millions of roots.
+        if ( opt.pdir || opt.top ) {
+            err = errno;
+            if ( ! realpath(path, fq) ) {
+                Dprint("error %d", errno);
+                logError(false, path);
+                continue;
+            }
+            errno = err;
+            path = fq;
+        }
+
+        fd = openDir(path);
+        if ( fd < 0 ) {
+            Dprint("error %d", errno);
+            logError(false, path);
+            continue;
+        }
+        if ( opt.uniq && ! dirIsNew(fd, path) ) {
+            (void)close(fd);
+            continue;
+        }
+
+        if ( ! pool.w || __atomic_load_n(&pool.queued, __ATOMIC_RELAXED)
+                         >= pool.fd_max ) {
+            cur_root  = list;
+            cur_depth = -1;
+            getFdStats(fd, path);
+            cur_root  = NULL;
+            continue;
+        }
+
+        g = list->grp;
+        if ( opt.pdj && fstat(fd, &sb) == 0 ) g = deviceGroup(sb.st_dev, g);
+        queueWork(&pool.w[g->first + g->next++ % g->num], fd, path, list, 0);
+    }
+
+    if ( ferror(list->from) ) logError(false, list->dir);
+    if ( list->from != stdin ) fclose(list->from);
+    free(buf);
+}
+
+/**
+ * Add the stats from a node entry (directory path) in the root table.
+ */
+void getDirStats(dir_node_s *dir_node)
+{
+    Dprint("%s", dir_node->dir);
+
+    if ( dir_node->from ) {
+        clock_gettime(CLOCK_MONOTONIC, &dir_node->start);
+        scanList(dir_node);
+        clock_gettime(CLOCK_MONOTONIC, &dir_node->stop);
+        return;
+    }
+
+    int fd = openRoot(dir_node);
+
+    if ( fd < 0 ) return;
+
+    cur_root  = dir_node;
+    cur_depth = -1;
+    clock_gettime(CLOCK_MONOTONIC, &dir_node->start);
+    getFdStats(fd, dir_node->dir);
+    clock_gettime(CLOCK_MONOTONIC, &dir_node->stop);
+    cur_root = NULL;
+}
+
+/**
+ * Open a root directory for scanning, or log why not and return -1.
+ */
+int openRoot(dir_node_s *dir_node)
+{
+    int fd = -1;
+
+    /// Its tree is counted as part of the outer root's.
+    if ( dir_node->outer ) return -1;
+
+    /// Rewind the descriptor held since `testDir()` and hand the scanner a
+    /// duplicate of it to close, so the root can be read again at will.
+    if ( dir_node->fd >= 0 ) {
+        fd = lseek(dir_node->fd, 0, SEEK_SET) == 0
+             ? fcntl(dir_node->fd, F_DUPFD_CLOEXEC, 0) : -1;
+    } else {
+        fd = openDir(dir_node->dir);
+    }
+
+    if ( fd < 0 ) {
+        Dprint("error %d", errno);
+        logError(false, dir_node->dir);
+    } else if ( opt.uniq && ! dirIsNew(fd, dir_node->dir) ) {
+        /// Already reached through another root, e.g. by a bind mount.
+        Dprint("%s: already counted", dir_node->dir);
+        (void)close(fd);
+        fd = -1;
+    }
+
+    return fd;
+}
+
+/**
+ * Count a single directory entry of the given `d_type` into `counts[]`. The
+ * type indexes the array directly, so there is nothing to compare or branch
+ * on here; `getValues()` sorts the buckets into their rows at report time.
+ */
+void addType(uint64_t *counts, unsigned char type)
+{
+    ++(counts[type & (DT_SLOTS - 1)]);
+    Dprint("d_type %hhu: %" PRIu64, type, counts[type & (DT_SLOTS - 1)]);
+}
+
+/**
+ * Fold `counts[]` alone into this thread's tally, as described for
+ * `addCounts()`.
+ */
+void addTypes(uint64_t *counts)
+{
+    int i = 0;
+
+    for ( i = 0 ; i < DT_SLOTS ; ++i ) {
+        if ( counts[i] ) {
+            __atomic_store_n(&tally->counts[i], tally->counts[i] + counts[i],
+                             __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * Fold `--sizes` byte totals, indexed by `d_type`, and `--ages` totals into
+ * this thread's tally, as `addTypes()` does counts.
+ */
+void addSizes(sizes_s *sz)
+{
+    int i = 0;
+
+    for ( i = 0 ; opt.age && i < AGE_SLOTS ; ++i ) {
+        __atomic_store_n(&tally->ages[i], tally->ages[i] + sz->ages[i],
+                         __ATOMIC_RELAXED);
+        __atomic_store_n(&tally->age_bytes[i],
+                         tally->age_bytes[i] + sz->age_bytes[i],
+                         __ATOMIC_RELAXED);
+    }
+
+    for ( i = 0 ; i < DT_SLOTS ; ++i ) {
+        if ( ! sz->bytes[i] && ! sz->alloc[i] ) continue;
+        __atomic_store_n(&tally->bytes[i], tally->bytes[i] + sz->bytes[i],
+                         __ATOMIC_RELAXED);
+        __atomic_store_n(&tally->alloc[i], tally->alloc[i] + sz->alloc[i],
+                         __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Fold one directory's worth of counts into this thread's tally. Readers
+ * count into a private array and only touch the tally here, once per
+ * directory. No other thread writes to it, so plain increments suffice; the
+ * stores are atomic only so that a continuous-output snapshot never reads a
+ * torn value.
+ *
+ * The directory and its entries are also counted to the root being read,
+ * for `--stats` to report per root. Workers that have stolen into the same
+ * tree share that root, so it takes atomic adds.
+ */
+void addCounts(uint64_t *counts, uint64_t ents, uint64_t reads)
+{
+    root_tally_s *rt = cur_root ? &cur_root->tally : NULL;
+
+    addTypes(counts);
+
+    __atomic_store_n(&tally->dirs,  tally->dirs + 1,      __ATOMIC_RELAXED);
+    __atomic_store_n(&tally->ents,  tally->ents + ents,   __ATOMIC_RELAXED);
+    __atomic_store_n(&tally->reads, tally->reads + reads, __ATOMIC_RELAXED);
+
+    if ( rt ) {
+        __atomic_fetch_add(&rt->dirs,  1,     __ATOMIC_RELAXED);
+        __atomic_fetch_add(&rt->ents,  ents,  __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * The `--ages` bucket for an entry last modified at `mtime`: the first of
+ * `AGE_LIMIT[]` that its age falls under, or the last for older ones. One
+ * modified since the scan began, or dated in the future, counts as new.
+ */
+int ageSlot(int64_t mtime)
+{
+    int64_t age = (int64_t)age_now - mtime;
+    int       i = 0;
+
+    while ( i < AGE_SLOTS - 1 && age >= AGE_LIMIT[i] ) ++i;
+    return i;
+}
+
+/**
+ * Count one directory, holding `counts[]`, into this thread's `--histogram`
+ * buckets: by the bit length of its number of entries, so that bucket `k`
+ * holds those with 2^(k-1) to 2^k - 1 of them and bucket 0 the empty ones,
+ * and with `--histogram-depth`, by its depth below its root. Only this
+ * thread writes its tally; see `addCounts()`.
+ */
+void addHist(uint64_t *counts)
+{
+    uint64_t n = 0;
+    int      i = 0;
+
+    for ( i = 0 ; i < DT_SLOTS ; ++i ) n += counts[i];
+    i = n ? 64 - __builtin_clzll(n) : 0;
+    __atomic_store_n(&tally->fan[i], tally->fan[i] + 1, __ATOMIC_RELAXED);
+
+    if ( ! opt.hdep ) return;
+
+    i = cur_depth < HIST_DEPTH ? cur_depth : HIST_DEPTH - 1;
+    __atomic_store_n(&tally->depth[i], tally->depth[i] + 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Offer the directory at `path`, holding `counts[]`, to the running thread's
+ * `--top` list. Most directories are turned away by one comparison with the
+ * smallest kept, and the path is only copied for one that gets in. The
+ * copy is `malloc()`ed, as it stays until pushed out, in no set order.
+ */
+void keepTop(char *path, uint64_t *counts)
+{
+    uint64_t n = 0;
+    int      i = 0;
+
+    for ( i = 0 ; i < DT_SLOTS ; ++i ) n += counts[i];
+    if ( top->num == opt.top && n <= top->ents[0].ents ) return;
+
+    pushTop(top, (top_ent_s){.ents = n, .path = strdup(path)});
+}
+
+/**
+ * Add `e` to the min-heap `t`: sifted up from the end while it has room,
+ * otherwise in place of the smallest, sifted down, if it is any bigger. The
+ * heap owns `e.path` from here on, freeing it or the displaced one's.
+ */
+void pushTop(top_s *t, top_ent_s e)
+{
+    size_t i = 0, j = 0;
+
+    if ( ! e.path ) logError(true, "unable to allocate top list");
+
+    if ( t->num < opt.top ) {
+        if ( t->num == t->cap ) {
+            t->cap  = t->cap ? t->cap * 2 : 64;
+            if ( t->cap > opt.top ) t->cap = opt.top;
+            t->ents = realloc(t->ents, t->cap * sizeof(top_ent_s));
+            if ( ! t->ents ) logError(true, "unable to allocate top list");
+        }
+        for ( i = t->num++ ; i > 0 ; i = j ) {
+            j = (i - 1) / 2;
+            if ( t->ents[j].ents <= e.ents ) break;
+            t->ents[i] = t->ents[j];
+        }
+        t->ents[i] = e;
+        return;
+    }
+
+    if ( e.ents <= t->ents[0].ents ) {
+        free(e.path);
+        return;
+    }
+
+    free(t->ents[0].path);
+    for ( i = 0 ; ( j = 2 * i + 1 ) < t->num ; i = j ) {
+        if ( j + 1 < t->num && t->ents[j + 1].ents < t->ents[j].ents ) ++j;
+        if ( t->ents[j].ents >= e.ents ) break;
+        t->ents[i] = t->ents[j];
+    }
+    t->ents[i] = e;
+}
+
+/**
+ * Order `--top` entries by entries, most first, then by path.
+ */
+static int cmpTop(const void *a, const void *b)
+{
+    const top_ent_s *x = a, *y = b;
+
+    if ( x->ents != y->ents ) return x->ents < y->ents ? 1 : -1;
+    return strcmp(x->path, y->path);
+}
+
+/**
+ * Move every worker's `--top` entries into the main thread's list, which so
+ * keeps the `opt.top` largest of all, then sort it for printing. The main
+ * list stops being a heap, so this is only done once the scan is over, and
+ * doing it again only sorts it again.
+ */
+void mergeTops()
+{
+    size_t i = 0;
+    int    w = 0;
+
+    for ( w = 0 ; w < pool.num ; ++w ) {
+        for ( i = 0 ; i < pool.w[w].top.num ; ++i ) {
+            pushTop(&main_top, pool.w[w].top.ents[i]);
+        }
+        free(pool.w[w].top.ents);
+        pool.w[w].top = (top_s){.ents = NULL, .num = 0, .cap = 0};
+    }
+
+    qsort(main_top.ents, main_top.num, sizeof(top_ent_s), cmpTop);
+}
+
+/**
+ * Sum every thread's tally into `de` and `ss`. Safe to call while workers
+ * are still scanning, in which case the result is a consistent-enough
+ * snapshot: each counter is exact as of some recent moment.
+ */
+void mergeTallies()
+{
+    tally_s *t = NULL;
+    int      i = 0, w = 0;
+
+    memset(de.counts, 0, sizeof(de.counts));
+    memset(de.bytes,  0, sizeof(de.bytes));
+    memset(de.alloc,  0, sizeof(de.alloc));
+    memset(de.fan,    0, sizeof(de.fan));
+    memset(de.depth,  0, sizeof(de.depth));
+    memset(de.ages,   0, sizeof(de.ages));
+    memset(de.age_bytes, 0, sizeof(de.age_bytes));
+    ss.ents = ss.dirs = ss.reads = ss.looks = 0;
+
+    for ( w = -1 ; w < pool.num ; ++w ) {
+        t = ( w < 0 ) ? &main_tally : &pool.w[w].tally;
+
+        for ( i = 0 ; i < DT_SLOTS ; ++i ) {
+            de.counts[i] += __atomic_load_n(&t->counts[i], __ATOMIC_RELAXED);
+            de.bytes[i]  += __atomic_load_n(&t->bytes[i],  __ATOMIC_RELAXED);
+            de.alloc[i]  += __atomic_load_n(&t->alloc[i],  __ATOMIC_RELAXED);
+        }
+        for ( i = 0 ; opt.hist && i < HIST_FAN ; ++i ) {
+            de.fan[i] += __atomic_load_n(&t->fan[i], __ATOMIC_RELAXED);
+        }
+        for ( i = 0 ; opt.hdep && i < HIST_DEPTH ; ++i ) {
+            de.depth[i] += __atomic_load_n(&t->depth[i], __ATOMIC_RELAXED);
+        }
+        for ( i = 0 ; opt.age && i < AGE_SLOTS ; ++i ) {
+            de.ages[i]      += __atomic_load_n(&t->ages[i], __ATOMIC_RELAXED);
+            de.age_bytes[i] += __atomic_load_n(&t->age_bytes[i],
+                                               __ATOMIC_RELAXED);
+        }
+        ss.ents  += __atomic_load_n(&t->ents,  __ATOMIC_RELAXED);
+        ss.dirs  += __atomic_load_n(&t->dirs,  __ATOMIC_RELAXED);
+        ss.reads += __atomic_load_n(&t->reads, __ATOMIC_RELAXED);
+        ss.looks += __atomic_load_n(&t->looks, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Gather the merged totals in `DT_TYPES[]` order. Any bucket that no row
+ * claims is folded into the `DT_UNKNOWN` row. With `--sizes`, the total
+ * apparent and allocated bytes follow, as line output's last two columns.
+ */
+void getValues(uint64_t *values)
+{
+    int i = 0;
+
+    mergeTallies();
+    foldSlots(de.counts, values);
+
+    if ( ! opt.size ) return;
+
+    values[de.num_hdr] = values[de.num_hdr + 1] = 0;
+    for ( i = 0 ; i < DT_SLOTS ; ++i ) {
+        values[de.num_hdr]     += de.bytes[i];
+        values[de.num_hdr + 1] += de.alloc[i];
+    }
+}
+
+/**
+ * Gather the `--sizes` totals merged by the last `getValues()` in
+ * `DT_TYPES[]` order, likewise.
+ */
+void getSizes(uint64_t *bytes, uint64_t *alloc)
+{
+    foldSlots(de.bytes, bytes);
+    foldSlots(de.alloc, alloc);
+}
+
+/**
+ * Sum `slots[]`, indexed by `d_type`, into `values[]` in `DT_TYPES[]` order,
+ * folding any slot that no row claims into the `DT_UNKNOWN` row.
+ */
+void foldSlots(const uint64_t *slots, uint64_t *values)
+{
+    bool claimed[DT_SLOTS] = {false};
+    int  i = 0, unk = -1;
+
+    for ( i = 0 ; i < de.num_hdr ; ++i ) {
+        values[i] = slots[DT_TYPES[i].type];
+        claimed[DT_TYPES[i].type] = true;
+        if ( DT_TYPES[i].type == DT_UNKNOWN ) unk = i;
+    }
+
+    if ( unk < 0 ) return;
+
+    for ( i = 0 ; i < DT_SLOTS ; ++i ) {
+        if ( ! claimed[i] ) values[unk] += slots[i];
+    }
+}
+
+/**
+ * Add the stats from an open directory descriptor to `de`. With `-r`, each
+ * sub-directory is opened relative to `fd` with `openat()` and read in turn,
+ * so no path strings are re-resolved during the descent, and none are built
+ * at all unless `--per-dir` needs them. Takes ownership of `fd`; `name` is
+ * only used for reporting.
+ */
+void getFdStats(int fd, char *name)
+{
+    ++cur_depth;
+    scanDir(fd, name, getFdStats);
+    --cur_depth;
+}
+
+/**
+ * Read one open directory with the selected reader, passing each
+ * sub-directory to `emit` when `-r` is selected. Takes ownership of `fd`.
+ */
+void scanDir(int fd, char *name, emit_fn emit)
+{
+#ifdef __linux__
+    if ( opt.dbuf > 0 ) {
+        getDentStats(fd, name, emit);
+        return;
+    }
+#endif
+
+    readDirStats(fd, name, emit);
+}
+
+/**
+ * Whether entry `name` of `fd`, of `d_type` `type`, is a sub-directory for
+ * `-r` to descend into. Where the filesystem leaves the type unknown, as XFS
+ * without `ftype`, some FUSE mounts and older NFS servers do, the entry is
+ * looked up with `fstatat()`, not following symlinks, so that whole subtrees
+ * are not skipped; `--resolve-unknown` then also types everything else.
+ */
+bool isSubDir(int fd, const char *name, unsigned char type)
+{
+    struct stat sb;
+
+    if ( type != DT_UNKNOWN ) return type == DT_DIR;
+
+    return fstatat(fd, name, &sb, AT_SYMLINK_NOFOLLOW) == 0
+           && S_ISDIR(sb.st_mode);
+}
+
+/**
+ * Open sub-directory `name` of `fd` for descent and count it into `counts[]`.
+ * `O_NOFOLLOW` guards against the entry being swapped for a symlink between
+ * reading it and `openat()`. With `--unique-inodes` the sub-directory is
+ * checked once open rather than by its `d_ino`, which for a bind mount is
+ * the inode underneath rather than the directory mounted there; one already
+ * seen is neither counted nor read again. Returns -1 if there is nothing to
+ * descend into.
+ */
+int openSub(int fd, char *name, uint64_t *counts)
+{
+    int sub_fd = openat(fd, name,
+                        O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+    if ( sub_fd < 0 ) {
+        Dprint("error %d", errno);
+        logError(false, name);
+    } else if ( opt.uniq && ! dirIsNew(sub_fd, name) ) {
+        (void)close(sub_fd);
+        return -1;
+    }
+
+    addType(counts, DT_DIR);
+    return sub_fd;
+}
+
+/**
+ * Append `name`, with its NUL, to the list at `*list` of `*len` bytes, in
+ * the calling thread's arena.
+ */
+void pushName(char **list, size_t *len, size_t *cap, const char *name)
+{
+    size_t n = strlen(name) + 1;
+
+    if ( *len + n > *cap ) {
+        *list = arenaGrow(arena, *list, *cap, ( *cap + n ) * 2);
+        *cap  = ( *cap + n ) * 2;
+    }
+    memcpy(*list + *len, name, n);
+    *len += n;
+}
+
+/**
+ * Look up entry `name` of directory `fd` with a plain system call. On Linux,
+ * `statx()` is asked for no more than is needed and may answer from the
+ * client's cache, which on NFS and FUSE saves a round trip per entry.
+ */
+void statEntry(int fd, const char *name, stat_rec_s *rec)
+{
+#if defined(__linux__) && defined(STATX_TYPE)
+    struct statx sx;
+
+    if ( statx(fd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC,
+               statMask(), &sx) == 0 ) {
+        statRec(&sx, rec);
+        return;
+    }
+#else
+    struct stat sb;
+
+    if ( fstatat(fd, name, &sb, AT_SYMLINK_NOFOLLOW) == 0 ) {
+        rec->type  = IFTODT(sb.st_mode);
+        rec->ino   = sb.st_ino;
+        rec->size  = (uint64_t)sb.st_size;
+        rec->alloc = (uint64_t)sb.st_blocks * 512;
+        rec->mtime = (int64_t)sb.st_mtime;
+        rec->dated = true;
+        return;
+    }
+#endif
+
+    Dprint("%s: error %d", name, errno);
+    memset(rec, 0, sizeof(*rec));
+    rec->type = DT_UNKNOWN;
+}
+
+#if defined(__linux__) && defined(STATX_TYPE)
+/**
+ * The `statx()` fields the selected modes need, and no more: every field
+ * asked for may cost the filesystem work to fill in.
+ */
+unsigned statMask()
+{
+    return STATX_TYPE | STATX_INO
+           | ( opt.size ? STATX_SIZE | STATX_BLOCKS : 0 )
+           | ( opt.age  ? STATX_SIZE | STATX_MTIME  : 0 );
+}
+
+/**
+ * Copy what `statx()` filled in of `sx` into `rec`. Fields it did not fill
+ * in are left at zero; without a type, the entry stays unknown.
+ */
+void statRec(const struct statx *sx, stat_rec_s *rec)
+{
+    memset(rec, 0, sizeof(*rec));
+    rec->type = ( sx->stx_mask & STATX_TYPE ) ? IFTODT(sx->stx_mode)
+                                              : DT_UNKNOWN;
+    rec->ino  = sx->stx_ino;
+    if ( sx->stx_mask & STATX_SIZE )   rec->size  = sx->stx_size;
+    if ( sx->stx_mask & STATX_BLOCKS ) rec->alloc = sx->stx_blocks * 512;
+    if ( sx->stx_mask & STATX_MTIME ) {
+        rec->mtime = sx->stx_mtime.tv_sec;
+        rec->dated = true;
+    }
+}
+#endif
+
+#ifdef HAVE_URING
+/**
+ * Set up an io_uring of at least `depth` entries and map its rings into `r`.
+ * Returns false, with `errno` set, where the kernel has no io_uring or a
+ * seccomp policy forbids it.
+ */
+bool uringInit(uring_s *r, unsigned depth)
+{
+    struct io_uring_params p;
+    bool   one = false;
+
+    memset(&p, 0, sizeof(p));
+    memset(r, 0, sizeof(*r));
+    r->depth = depth;
+    r->fd    = (int)syscall(__NR_io_uring_setup, depth, &p);
+    if ( r->fd < 0 ) return false;
+
+    /// The kernel rounds the queue up to a power of two; `depth` still caps
+    /// what is in flight.
+    r->sq_len  = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_len  = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->sqe_len = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    /// Since Linux 5.4 both rings share the one mapping.
+    one = p.features & IORING_FEAT_SINGLE_MMAP;
+    if ( one ) r->sq_len = r->cq_len = MAX(r->sq_len, r->cq_len);
+
+    r->sq_map = mmap(NULL, r->sq_len, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    r->cq_map = one ? r->sq_map
+                    : mmap(NULL, r->cq_len, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, r->fd,
+                           IORING_OFF_CQ_RING);
+    r->sqes   = mmap(NULL, r->sqe_len, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if ( r->sq_map == MAP_FAILED || r->cq_map == MAP_FAILED
+         || r->sqes == MAP_FAILED ) {
+        uringFree(r);
+        return false;
+    }
+
+    r->sq_head  = (unsigned *)((char *)r->sq_map + p.sq_off.head);
+    r->sq_tail  = (unsigned *)((char *)r->sq_map + p.sq_off.tail);
+    r->sq_mask  = (unsigned *)((char *)r->sq_map + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)((char *)r->sq_map + p.sq_off.array);
+    r->cq_head  = (unsigned *)((char *)r->cq_map + p.cq_off.head);
+    r->cq_tail  = (unsigned *)((char *)r->cq_map + p.cq_off.tail);
+    r->cq_mask  = (unsigned *)((char *)r->cq_map + p.cq_off.ring_mask);
+    r->cqes     = (struct io_uring_cqe *)((char *)r->cq_map + p.cq_off.cqes);
+    return true;
+}
+
+/**
+ * Unmap and close ring `r`, however far `uringInit()` got with it.
+ */
+void uringFree(uring_s *r)
+{
+    int err = errno;
+
+    if ( r->sqes && r->sqes != MAP_FAILED ) munmap(r->sqes, r->sqe_len);
+    if ( r->cq_map && r->cq_map != MAP_FAILED && r->cq_map != r->sq_map ) {
+        munmap(r->cq_map, r->cq_len);
+    }
+    if ( r->sq_map && r->sq_map != MAP_FAILED ) munmap(r->sq_map, r->sq_len);
+    if ( r->fd >= 0 ) (void)close(r->fd);
+
+    r->sqes = NULL;
+    r->sq_map = r->cq_map = NULL;
+    r->fd = -1;
+    errno = err;
+}
+
+/**
+ * Look up `n` entries of directory `fd` through ring `r`. The submission
+ * queue is kept full: each pass tops it up, waits for at least one
+ * completion, and reaps every one there is, in whatever order the kernel's
+ * workers finished them. A request the kernel does not recognise (before
+ * Linux 5.6) comes back `-EINVAL` and is looked up directly instead.
+ */
+void uringStat(uring_s *r, int fd, char **names, size_t n, stat_rec_s *recs)
+{
+    arena_mark_s         mark = arenaMark(arena);
+    struct statx        *sx = arenaAlloc(arena, n * sizeof(*sx),
+                                         _Alignof(struct statx));
+    struct io_uring_sqe *sqe = NULL;
+    struct io_uring_cqe *cqe = NULL;
+    size_t   next = 0, done = 0, i = 0;
+    unsigned flight = 0, tail = 0, head = 0, todo = 0;
+
+    while ( done < n ) {
+        tail = *r->sq_tail;
+        for ( ; next < n && flight < r->depth ; ++next, ++flight, ++tail ) {
+            sqe = &r->sqes[tail & *r->sq_mask];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode      = IORING_OP_STATX;
+            sqe->fd          = fd;
+            sqe->addr        = (uintptr_t)names[next];
+            sqe->len         = statMask();
+            sqe->off         = (uintptr_t)&sx[next];
+            sqe->statx_flags = AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC;
+            sqe->user_data   = next;
+            r->sq_array[tail & *r->sq_mask] = tail & *r->sq_mask;
+        }
+        __atomic_store_n(r->sq_tail, tail, __ATOMIC_RELEASE);
+
+        /// Submit whatever the kernel has yet to take, and wait for one.
+        todo = tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+        if ( syscall(__NR_io_uring_enter, r->fd, todo, 1,
+                     IORING_ENTER_GETEVENTS, NULL, 0) < 0
+             && errno != EINTR && errno != EAGAIN && errno != EBUSY ) {
+            logError(true, "io_uring_enter");
+        }
+
+        head = *r->cq_head;
+        while ( head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE) ) {
+            cqe = &r->cqes[head & *r->cq_mask];
+            i   = cqe->user_data;
+            if ( cqe->res == 0 ) {
+                statRec(&sx[i], &recs[i]);
+            } else if ( cqe->res == -EINVAL ) {
+                statEntry(fd, names[i], &recs[i]);
+            } else {
+                Dprint("%s: error %d", names[i], -cqe->res);
+                memset(&recs[i], 0, sizeof(recs[i]));
+                recs[i].type = DT_UNKNOWN;
+            }
+            ++head;
+            ++done;
+            --flight;
+        }
+        __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    arenaRelease(arena, mark);
+}
+#endif
+
+/**
+ * Look up `n` entries of directory `fd` into `recs[]`: through the calling
+ * thread's io_uring with `--stat-queue`, set up on first use, or else one
+ * system call at a time.
+ */
+void statBatch(int fd, char **names, size_t n, stat_rec_s *recs)
+{
+    size_t i = 0;
+#ifdef HAVE_URING
+    int    err = errno;
+
+    /// Without a ring, plain system calls do the same work, so the reason
+    /// is kept for `--stats` alone and not left to set the exit status.
+    if ( opt.sq > 0 && ring.depth == 0 && ! uringInit(&ring, opt.sq) ) {
+        Dprint("io_uring_setup: error %d", errno);
+        __atomic_store_n(&uring_err, errno, __ATOMIC_RELAXED);
+        errno = err;
+    }
+    if ( ring.fd >= 0 ) {
+        uringStat(&ring, fd, names, n, recs);
+        return;
+    }
+#endif
+
+    for ( ; i < n ; ++i ) statEntry(fd, names[i], &recs[i]);
+}
+
+/**
+ * Release the calling thread's share of the stat layer.
+ */
+void statDone()
+{
+#ifdef HAVE_URING
+    if ( ring.fd >= 0 ) uringFree(&ring);
+#endif
+}
+
+/**
+ * With `--per-dir` or `--top`, the path of entry `sub` of the directory at
+ * `dir`, built in the calling thread's arena; otherwise, or without `dir`,
+ * just `sub`.
+ */
+char *subPath(char *dir, char *sub)
+{
+    size_t n = 0;
+    char  *p = NULL;
+
+    if ( ! ( opt.pdir || opt.top ) || ! dir ) return sub;
+
+    n = strlen(dir);
+    if ( n > 0 && dir[n - 1] == '/' ) --n;
+    p = arenaAlloc(arena, n + strlen(sub) + 2, 1);
+    memcpy(p, dir, n);
+    p[n] = '/';
+    strcpy(p + n + 1, sub);
+
+    return p;
+}
+
+/**
+ * Look up each of the `len` bytes of NUL-separated entry names of `fd` in
+ * `names`, and count it into `counts[]` as the readers would have, and its
+ * bytes and age into `sz`. These are the entries whose `d_type` came back
+ * `DT_UNKNOWN`, as on XFS without `ftype`, some FUSE mounts and older NFS
+ * servers, or with `--sizes` or `--ages`, every entry. Symlinks are not
+ * followed. With `-r`, sub-directories found this way are opened and handed
+ * to `emit` like any other, named as `subPath()` of `dir`. An entry that
+ * cannot be examined, e.g. one removed since, stays unknown.
+ */
+void resolveList(int fd, char *dir, char *names, size_t len,
+                 uint64_t *counts, sizes_s *sz, emit_fn emit)
+{
+    arena_mark_s mark = arenaMark(arena);
+    stat_rec_s  *recs = NULL;
+    char       **name = NULL;
+    uint16_t       di = opt.uniq ? fdDevIndex(fd) : 0;
+    size_t          n = 0, i = 0, off = 0;
+    int        sub_fd = -1, t = 0, a = 0;
+
+    for ( off = 0 ; off < len ; off += strlen(names + off) + 1 ) ++n;
+    name = arenaAlloc(arena, n * sizeof(*name), _Alignof(char *));
+    recs = arenaAlloc(arena, n * sizeof(*recs), _Alignof(stat_rec_s));
+    for ( off = 0 ; off < len ; off += strlen(names + off) + 1 ) {
+        name[i++] = names + off;
+    }
+
+    statBatch(fd, name, n, recs);
+
+    for ( i = 0 ; i < n ; ++i ) {
+        t = recs[i].type & (DT_SLOTS - 1);
+
+        if ( opt.rec && t == DT_DIR ) {
+            sub_fd = openSub(fd, name[i], counts);
+            /// With `--unique-inodes`, a directory seen before is not counted.
+            if ( sub_fd < 0 && opt.uniq ) continue;
+            if ( sub_fd >= 0 ) emit(sub_fd, subPath(dir, name[i]));
+        } else if ( opt.uniq && t != DT_UNKNOWN
+                    && ! inoInsert(di, recs[i].ino) ) {
+            continue;
+        } else {
+            addType(counts, t);
+        }
+
+        sz->bytes[t] += recs[i].size;
+        sz->alloc[t] += recs[i].alloc;
+
+        if ( opt.age && recs[i].dated ) {
+            a = ageSlot(recs[i].mtime);
+            ++(sz->ages[a]);
+            sz->age_bytes[a] += recs[i].size;
+        }
+    }
+
+    __atomic_store_n(&tally->looks, tally->looks + n, __ATOMIC_RELAXED);
+    arenaRelease(arena, mark);
+}
+
+/**
+ * Look up the listed entries of one directory, as for `resolveList()`, in
+ * batches of `RESOLVE_BATCH` names. A pool worker queues each, with a
+ * duplicate of `fd`, for idle workers to steal, so that a directory of
+ * millions of them is not stat'ed one entry at a time on one thread. Outside
+ * the pool, once descriptors run short, or with `--per-dir`, `--top` or
+ * `--histogram`, which need the whole directory's counts, they are looked
+ * up here.
+ *
+ * The readers call this as they go, with `last` unset, whenever they have
+ * gathered a batch: only whole batches are handed on, and the bytes of
+ * `names` used are returned for the caller to drop. Once the directory has
+ * been read, `last` hands on everything, keeping the first batch to look up
+ * here, as the reader has nothing else left to do.
+ */
+size_t resolveEntries(int fd, char *dir, char *names, size_t len,
+                      uint64_t *counts, sizes_s *sz, emit_fn emit, bool last)
+{
+    size_t keep = 0, start = 0, off = 0, n = 0;
+    int    bfd = -1;
+
+    for ( n = 0 ; last && keep < len && n < RESOLVE_BATCH ; ++n ) {
+        keep += strlen(names + keep) + 1;
+    }
+
+    /// Queue the rest first, so that thieves start on them while we stat.
+    for ( start = off = keep ; start < len ; start = off ) {
+        for ( n = 0 ; off < len && n < RESOLVE_BATCH ; ++n ) {
+            off += strlen(names + off) + 1;
+        }
+        if ( ! last && n < RESOLVE_BATCH ) return start;
+
+        if ( self && ! opt.pdir && ! opt.top && ! opt.hist
+             && __atomic_load_n(&pool.queued, __ATOMIC_RELAXED) < pool.fd_max
+             && ( bfd = fcntl(fd, F_DUPFD_CLOEXEC, 0) ) >= 0 ) {
+            queueBatch(self, bfd, names + start, off - start, cur_root,
+                       cur_depth);
+        } else {
+            resolveList(fd, dir, names + start, off - start, counts, sz,
+                        emit);
+        }
+    }
+
+    if ( keep ) resolveList(fd, dir, names, keep, counts, sz, emit);
+    return len;
+}
+
+/**
+ * Portable reader built on `readdir()`. Sub-directories are handed to `emit`
+ * as they are found. With `--per-dir`, its row is written once the whole
+ * directory is counted. Takes ownership of `fd`.
+ */
+void readDirStats(int fd, char *name, emit_fn emit)
+{
+    DIR *dp = fdopendir(fd);
+    struct dirent *ep = NULL; // from sys/dirent.h
+    char   *looks = NULL; /// NUL-separated names to look up
+    size_t  look_len = 0, look_cap = 0, look_n = 0;
+    arena_mark_s mark = arenaMark(arena);
+    int sub_fd = -1;
+    uint64_t counts[DT_SLOTS] = {0};
+    sizes_s  sz = {{0}, {0}, {0}, {0}};
+    uint64_t ents = 0;
+    uint16_t   di = opt.uniq ? fdDevIndex(fd) : 0;
+
+    if ( ! dp ) {
+        Dprint("error %d", errno);
+        logError(false, name);
+        (void)close(fd);
+        return;
+    }
+
+    while ( (ep = readdir(dp)) ) {
+        ++ents;
+
+        /// Neither count nor descend into ourselves or our parent.
+        if ( strcmp(ep->d_name, CD) == 0 || strcmp(ep->d_name, PD) == 0 ) {
+            continue;
+        }
+
+        Dprint("ep = %hhu", ep->d_type);
+
+        /// Entries to look up are handed to `resolveEntries()` a batch at
+        /// a time, so the list never outgrows one.
+        if ( opt.size || opt.age
+             || ( opt.unk && ep->d_type == DT_UNKNOWN ) ) {
+            pushName(&looks, &look_len, &look_cap, ep->d_name);
+            if ( ++look_n == RESOLVE_BATCH ) {
+                (void)resolveEntries(dirfd(dp), name, looks, look_len, counts,
+                                     &sz, emit, false);
+                look_len = look_n = 0;
+            }
+            continue;
+        }
+
+        if ( opt.rec && isSubDir(dirfd(dp), ep->d_name, ep->d_type) ) {
+            sub_fd = openSub(dirfd(dp), ep->d_name, counts);
+            if ( sub_fd >= 0 ) emit(sub_fd, subPath(name, ep->d_name));
+            continue;
+        }
+
+        if ( opt.uniq && ! inoInsert(di, ep->d_ino) ) continue;
+        addType(counts, ep->d_type);
+    }
+
+    if ( look_len ) {
+        (void)resolveEntries(dirfd(dp), name, looks, look_len, counts, &sz,
+                             emit, true);
+    }
+
+    if ( opt.size || opt.age ) addSizes(&sz);
+    if ( opt.pdir ) putRow(name, counts, &sz);
+    if ( opt.top )  keepTop(name, counts);
+    if ( opt.hist ) addHist(counts);
+    addCounts(counts, ents, 0);
+    arenaRelease(arena, mark);
+    (void)closedir(dp);
+}
+
+/**
+ * Portable histogram kernel. Alternating between four private tables keeps
+ * runs of the same type (the usual case) from stalling on the previous
+ * increment of one counter.
+ */
+void histScalar(const unsigned char *types, size_t n, uint64_t *counts)
+{
+    uint64_t part[4][DT_SLOTS] = {{0}};
+    size_t   i = 0;
+    int      v = 0;
+
+    for ( ; i + 4 <= n ; i += 4 ) {
+        ++part[0][types[i]];
+        ++part[1][types[i + 1]];
+        ++part[2][types[i + 2]];
+        ++part[3][types[i + 3]];
+    }
+    for ( ; i < n ; ++i ) ++part[0][types[i]];
+
+    for ( v = 0 ; v < DT_SLOTS ; ++v ) {
+        counts[v] += part[0][v] + part[1][v] + part[2][v] + part[3][v];
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/**
+ * SSE4.2 histogram kernel. Each type value keeps a vector of byte-wide
+ * counters, bumped by subtracting the all-ones compare mask; the lanes are
+ * summed with `psadbw` before they can wrap at 255.
+ */
+__attribute__((target("sse4.2")))
+void histSSE42(const unsigned char *types, size_t n, uint64_t *counts)
+{
+    __m128i acc[DT_SLOTS], x, sum;
+    size_t  i = 0, j = 0, blk = 0;
+    int     v = 0;
+
+    while ( n - i >= 16 ) {
+        blk = (n - i) / 16;
+        if ( blk > 255 ) blk = 255;
+
+        for ( v = 0 ; v < DT_SLOTS ; ++v ) acc[v] = _mm_setzero_si128();
+
+        for ( j = 0 ; j < blk ; ++j, i += 16 ) {
+            x = _mm_loadu_si128((const __m128i *)(types + i));
+            for ( v = 0 ; v < DT_SLOTS ; ++v ) {
+                acc[v] = _mm_sub_epi8(acc[v],
+                                      _mm_cmpeq_epi8(x, _mm_set1_epi8(v)));
+            }
+        }
+
+        for ( v = 0 ; v < DT_SLOTS ; ++v ) {
+            sum = _mm_sad_epu8(acc[v], _mm_setzero_si128());
+            counts[v] += (uint64_t)_mm_cvtsi128_si32(sum)
+                         + (uint64_t)_mm_extract_epi16(sum, 4);
+        }
+    }
+
+    histScalar(types + i, n - i, counts);
+}
+
+/**
+ * AVX2 histogram kernel; as `histSSE42()`, 32 entries at a time.
+ */
+__attribute__((target("avx2")))
+void histAVX2(const unsigned char *types, size_t n, uint64_t *counts)
+{
+    __m256i acc[DT_SLOTS], x, sum;
+    size_t  i = 0, j = 0, blk = 0;
+    int     v = 0;
+
+    while ( n - i >= 32 ) {
+        blk = (n - i) / 32;
+        if ( blk > 255 ) blk = 255;
+
+        for ( v = 0 ; v < DT_SLOTS ; ++v ) acc[v] = _mm256_setzero_si256();
+
+        for ( j = 0 ; j < blk ; ++j, i += 32 ) {
+            x = _mm256_loadu_si256((const __m256i *)(types + i));
+            for ( v = 0 ; v < DT_SLOTS ; ++v ) {
+                acc[v] = _mm256_sub_epi8(acc[v],
+                                         _mm256_cmpeq_epi8(x,
+                                             _mm256_set1_epi8(v)));
+            }
+        }
+
+        for ( v = 0 ; v < DT_SLOTS ; ++v ) {
+            sum = _mm256_sad_epu8(acc[v], _mm256_setzero_si256());
+            counts[v] += (uint64_t)_mm256_extract_epi16(sum, 0)
+                         + (uint64_t)_mm256_extract_epi16(sum, 4)
+                         + (uint64_t)_mm256_extract_epi16(sum, 8)
+                         + (uint64_t)_mm256_extract_epi16(sum, 12);
+        }
+    }
+
+    histScalar(types + i, n - i, counts);
+}
+#endif
+
+/**
+ * Select the histogram kernel for the running CPU, so one binary runs
+ * everywhere and still uses the widest vectors available.
+ */
+void pickHist()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports("avx2") ) {
+        histTypes = histAVX2;
+        hist_name = "avx2";
+    } else if ( __builtin_cpu_supports("sse4.2") ) {
+        histTypes = histSSE42;
+        hist_name = "sse4.2";
+    }
+#endif
+    Dprint("histogram kernel: %s", hist_name);
+}
+
+#ifdef __linux__
+/**
+ * Linux reader: fill `dent_buf` with packed `linux_dirent64` records straight
+ * from the kernel, so a directory of millions of entries costs a handful of
+ * system calls rather than one per libc refill. The only per-entry work is
+ * gathering each `d_type` byte into `dent_types[]`; the whole fill is then
+ * counted at once by the `histTypes` kernel.
+ *
+ * The thread's buffer is shared by every level of a `-r` descent, so the
+ * names of any sub-directories are set aside and only opened and handed to
+ * `emit` once this directory has been read to the end. Takes ownership of
+ * `fd`.
+ */
+void getDentStats(int fd, char *name, emit_fn emit)
+{
+    struct linux_dirent64 *dp = NULL;
+    char    *subs    = NULL; /// NUL-separated sub-directory names
+    char    *looks   = NULL; /// and those to look up
+    size_t   sub_len = 0, sub_cap = 0, look_len = 0, look_cap = 0;
+    size_t   look_n = 0, off = 0, n = 0;
+    arena_mark_s mark = arenaMark(arena);
+    long     nread   = 0;
+    int      sub_fd  = -1;
+    uint64_t counts[DT_SLOTS] = {0};
+    sizes_s  sz = {{0}, {0}, {0}, {0}};
+    uint64_t ents = 0, reads = 0;
+    uint16_t   di = opt.uniq ? fdDevIndex(fd) : 0;
+
+    for ( ;; ) {
+        nread = syscall(SYS_getdents64, fd, dent_buf, opt.dbuf);
+        ++reads;
+
+        if ( nread == 0 ) break;
+        if ( nread < 0 ) {
+            Dprint("error %d", errno);
+            logError(false, name);
+            break;
+        }
+
+        for ( off = 0, n = 0 ; off < (size_t)nread ; off += dp->d_reclen ) {
+            dp = (struct linux_dirent64 *)(dent_buf + off);
+            ++ents;
+
+            /// Neither count nor descend into ourselves or our parent.
+            if ( dp->d_name[0] == '.'
+                 && ( strcmp(dp->d_name, CD) == 0
+                      || strcmp(dp->d_name, PD) == 0 ) ) {
+                continue;
+            }
+
+            /// Entries to look up wait for the end of this fill.
+            if ( opt.size || opt.age
+                 || ( opt.unk && dp->d_type == DT_UNKNOWN ) ) {
+                pushName(&looks, &look_len, &look_cap, dp->d_name);
+                ++look_n;
+                continue;
+            }
+
+            /// Sub-directories are counted by `openSub()` below.
+            if ( opt.rec && isSubDir(fd, dp->d_name, dp->d_type) ) {
+                pushName(&subs, &sub_len, &sub_cap, dp->d_name);
+                continue;
+            }
+
+            if ( opt.uniq && ! inoInsert(di, dp->d_ino) ) continue;
+            dent_types[n++] = dp->d_type & (DT_SLOTS - 1);
+        }
+
+        histTypes(dent_types, n, counts);
+
+        /// Hand on every whole batch of entries to look up, and keep the
+        /// rest for the next. Not before now: descending into what they turn
+        /// up may read another directory through `dent_buf`.
+        if ( look_n >= RESOLVE_BATCH ) {
+            off = resolveEntries(fd, name, looks, look_len, counts, &sz, emit,
+                                 false);
+            memmove(looks, looks + off, look_len - off);
+            look_len -= off;
+            look_n   %= RESOLVE_BATCH;
+        }
+    }
+
+    for ( off = 0 ; off < sub_len ; off += strlen(subs + off) + 1 ) {
+        sub_fd = openSub(fd, subs + off, counts);
+        if ( sub_fd >= 0 ) emit(sub_fd, subPath(name, subs + off));
+    }
+
+    if ( look_len ) {
+        (void)resolveEntries(fd, name, looks, look_len, counts, &sz, emit,
+                             true);
+    }
+
+    if ( opt.size || opt.age ) addSizes(&sz);
+    if ( opt.pdir ) putRow(name, counts, &sz);
+    if ( opt.top )  keepTop(name, counts);
+    if ( opt.hist ) addHist(counts);
+    addCounts(counts, ents, reads);
+
+    arenaRelease(arena, mark);
+    (void)close(fd);
+}
+#endif
+
+/**
+ * Finalising mix from SplitMix64, spreading consecutive inode numbers over
+ * every shard and slot.
+ */
+uint64_t inoHash(uint16_t di, uint64_t ino)
+{
+    uint64_t h = ino + (uint64_t)di * 0x9e3779b97f4a7c15ULL;
+
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+/**
+ * Allocate every shard of the `--unique-inodes` set at its starting size.
+ */
+void initInoSet()
+{
+    ino_shard_s *sh = NULL;
+    int          i  = 0;
+
+    for ( i = 0 ; i < INO_SHARDS ; ++i ) {
+        sh = &inos.shard[i];
+        pthread_mutex_init(&sh->lock, NULL);
+        sh->cap  = INO_SHARD_MIN;
+        sh->used = 0;
+        sh->ino  = malloc(sh->cap * sizeof(*sh->ino));
+        sh->dev  = calloc(sh->cap, sizeof(*sh->dev));
+        if ( ! sh->ino || ! sh->dev ) {
+            logError(true, "unable to allocate inode set");
+        }
+    }
+}
+
+/**
+ * Return the set's index for `dev`. Devices are only ever appended, so the
+ * list is searched without the lock, which is only taken to add one. Each
+ * thread remembers the last device it asked about, since a reader asks once
+ * per directory and a tree seldom changes device.
+ */
+uint16_t devIndex(dev_t dev)
+{
+    int i = 0, n = 0;
+
+    if ( last_di >= 0 && last_dev == dev ) return (uint16_t)last_di;
+
+    n = __atomic_load_n(&inos.num_devs, __ATOMIC_ACQUIRE);
+    for ( i = 0 ; i < n && inos.devs[i] != dev ; ++i ) ;
+
+    if ( i == n ) {
+        pthread_mutex_lock(&inos.lock);
+        for ( n = inos.num_devs ; i < n && inos.devs[i] != dev ; ++i ) ;
+        if ( i == n ) {
+            if ( n == INO_DEVS_MAX ) {
+                errno = EOVERFLOW;
+                logError(true, "too many devices for --unique-inodes");
+            }
+            inos.devs[n] = dev;
+            __atomic_store_n(&inos.num_devs, n + 1, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&inos.lock);
+    }
+
+    last_dev = dev;
+    last_di  = i;
+    return (uint16_t)i;
+}
+
+/**
+ * Double a shard, re-inserting everything it holds. Called with its lock.
+ */
+static void growShard(ino_shard_s *sh)
+{
+    size_t    cap = sh->cap * 2, i = 0, j = 0;
+    uint64_t *ino = malloc(cap * sizeof(*ino));
+    uint16_t *dev = calloc(cap, sizeof(*dev));
+
+    if ( ! ino || ! dev ) logError(true, "unable to grow inode set");
+
+    for ( i = 0 ; i < sh->cap ; ++i ) {
+        if ( ! sh->dev[i] ) continue;
+        j = inoHash(sh->dev[i] - 1, sh->ino[i]) & (cap - 1);
+        while ( dev[j] ) j = (j + 1) & (cap - 1);
+        ino[j] = sh->ino[i];
+        dev[j] = sh->dev[i];
+    }
+
+    free(sh->ino);
+    free(sh->dev);
+    sh->ino = ino;
+    sh->dev = dev;
+    sh->cap = cap;
+}
+
+/**
+ * Record inode `ino` on device index `di`, returning true the first time it
+ * is seen. The top byte of the hash picks the shard and the low bits the
+ * slot, probing linearly from there.
+ */
+bool inoInsert(uint16_t di, uint64_t ino)
+{
+    uint64_t     h  = inoHash(di, ino);
+    ino_shard_s *sh = &inos.shard[h >> 56];
+    size_t       i  = 0;
+
+    pthread_mutex_lock(&sh->lock);
+
+    if ( (sh->used + 1) * 10 > sh->cap * 7 ) growShard(sh);
+
+    for ( i = h & (sh->cap - 1) ; sh->dev[i] ; i = (i + 1) & (sh->cap - 1) ) {
+        if ( sh->ino[i] == ino && sh->dev[i] == di + 1 ) {
+            pthread_mutex_unlock(&sh->lock);
+            __atomic_fetch_add(&inos.dups, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+    }
+
+    sh->ino[i] = ino;
+    sh->dev[i] = di + 1;
+    ++sh->used;
+
+    pthread_mutex_unlock(&sh->lock);
+    return true;
+}
+
+/**
+ * Return the set's index for the device holding open directory `fd`.
+ */
+uint16_t fdDevIndex(int fd)
+{
+    struct stat sb;
+
+    if ( fstat(fd, &sb) != 0 ) {
+        Dprint("error %d", errno);
+        sb.st_dev = 0;
+    }
+
+    return devIndex(sb.st_dev);
+}
+
+/**
+ * Check a directory just opened on `fd`, returning true if it has not been
+ * seen before. One that cannot be examined is taken to be new.
+ */
+bool dirIsNew(int fd, char *name)
+{
+    struct stat sb;
+
+    if ( fstat(fd, &sb) != 0 ) {
+        Dprint("error %d", errno);
+        logError(false, name);
+        return true;
+    }
+
+    return inoInsert(devIndex(sb.st_dev), (uint64_t)sb.st_ino);
+}
+
+/**
+ * Bytes held by the tables of the `--unique-inodes` set.
+ */
+size_t inoBytes()
+{
+    size_t bytes = 0;
+    int    i     = 0;
+
+    for ( i = 0 ; i < INO_SHARDS ; ++i ) {
+        bytes += inos.shard[i].cap
+                 * ( sizeof(*inos.shard[i].ino) + sizeof(*inos.shard[i].dev) );
+    }
+
+    return bytes;
+}
+
+/**
+ * Number of distinct (device, inode) pairs held by the set.
+ */
+uint64_t inoCount()
+{
+    uint64_t n = 0;
+    int      i = 0;
+
+    for ( i = 0 ; i < INO_SHARDS ; ++i ) n += inos.shard[i].used;
+
+    return n;
+}
+
+/**
+ * Raise the soft open-file limit as far as the hard limit allows and return
+ * the result. Every directory waiting in a pool deque holds a descriptor.
+ */
+rlim_t raiseFdLimit()
+{
+    struct rlimit rl;
+
+    if ( getrlimit(RLIMIT_NOFILE, &rl) != 0 ) return 256;
+
+    if ( rl.rlim_cur < rl.rlim_max ) {
+        rlim_t want = rl.rlim_max;
+#ifdef OPEN_MAX
+        if ( want > OPEN_MAX ) want = OPEN_MAX; /// Darwin refuses more.
+#endif
+        rl.rlim_cur = want;
+        if ( setrlimit(RLIMIT_NOFILE, &rl) != 0 ) {
+            Dprint("setrlimit error %d", errno);
+            errno = 0;
+        }
+        (void)getrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    Dprint("RLIMIT_NOFILE: %llu", (unsigned long long)rl.rlim_cur);
+    return rl.rlim_cur;
+}
+
+/**
+ * `emit_fn` for workers: queue a sub-directory on the calling worker's deque.
+ * Once too many descriptors are waiting in deques, the sub-directory is read
+ * inline instead, which keeps the pool within the open-file limit however
+ * wide the tree.
+ */
+void pushWork(int fd, char *name)
+{
+    if ( __atomic_load_n(&pool.queued, __ATOMIC_RELAXED) >= pool.fd_max ) {
+        ++cur_depth;
+        scanDir(fd, name, pushWork);
+        --cur_depth;
+        return;
+    }
+
+    queueWork(self, fd, name, cur_root, cur_depth + 1);
+}
+
+/**
+ * Queue an open directory under `root`, `depth` levels below it, on worker
+ * `w`'s deque. Its name is copied with `strdup()`, not into this thread's
+ * arena: whichever worker takes the item frees it, in no set order.
+ */
+void queueWork(worker_s *w, int fd, char *name, dir_node_s *root,
+               int depth)
+{
+    queueItem(w, (work_s){.fd = fd, .name = strdup(name), .root = root,
+                          .depth = depth});
+}
+
+/**
+ * Queue `len` bytes of NUL-separated entry names of `fd`, under `root`, for
+ * a worker to resolve with `resolveList()`. The names are copied, as the
+ * caller's live in its arena, into one `malloc()` for the whole batch.
+ */
+void queueBatch(worker_s *w, int fd, char *names, size_t len,
+                dir_node_s *root, int depth)
+{
+    char *copy = malloc(len);
+
+    if ( ! copy ) logError(true, "unable to allocate work queue");
+    queueItem(w, (work_s){.fd = fd, .name = memcpy(copy, names, len),
+                          .root = root, .depth = depth, .batch = len});
+}
+
+/**
+ * Put `item` on worker `w`'s deque, and wake a sleeping worker to steal it.
+ */
+void queueItem(worker_s *w, work_s item)
+{
+    deque_s *dq = &w->dq;
+
+    __atomic_fetch_add(&pool.pending, 1, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&item.root->pending, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&dq->lock);
+    if ( dq->tail == dq->cap ) {
+        if ( dq->head > 0 ) {
+            memmove(dq->items, dq->items + dq->head,
+                    (dq->tail - dq->head) * sizeof(work_s));
+            dq->tail -= dq->head;
+            dq->head  = 0;
+        } else {
+            dq->cap   = dq->cap ? dq->cap * 2 : 64;
+            dq->items = realloc(dq->items, dq->cap * sizeof(work_s));
+            if ( ! dq->items ) logError(true, "unable to allocate work queue");
+        }
+    }
+    dq->items[dq->tail] = item;
+    ++(dq->tail);
+    pthread_mutex_unlock(&dq->lock);
+
+    __atomic_fetch_add(&pool.queued, 1, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&w->grp->queued, 1, __ATOMIC_SEQ_CST);
+    if ( __atomic_load_n(&w->grp->sleepers, __ATOMIC_SEQ_CST) > 0 ) {
+        pthread_mutex_lock(&pool.lock);
+        pthread_cond_signal(&w->grp->wake);
+        pthread_mutex_unlock(&pool.lock);
+    }
+}
+
+/**
+ * Wake every sleeping worker in every group, e.g. once the last directory
+ * has been read and they can all go home.
+ */
+void wakeAll()
+{
+    int i = 0;
+
+    pthread_mutex_lock(&pool.lock);
+    for ( i = 0 ; i < __atomic_load_n(&pool.num_g, __ATOMIC_ACQUIRE) ; ++i ) {
+        pthread_cond_broadcast(&pool.g[i].wake);
+    }
+    pthread_mutex_unlock(&pool.lock);
+}
+
+/**
+ * Take the newest work item from the calling worker's own deque.
+ */
+bool popWork(worker_s *self, work_s *item)
+{
+    deque_s *dq = &self->dq;
+    bool     got = false;
+
+    pthread_mutex_lock(&dq->lock);
+    if ( dq->tail > dq->head ) {
+        *item = dq->items[--(dq->tail)];
+        if ( dq->tail == dq->head ) dq->head = dq->tail = 0;
+        got = true;
+    }
+    pthread_mutex_unlock(&dq->lock);
+
+    if ( got ) {
+        __atomic_fetch_sub(&pool.queued, 1, __ATOMIC_SEQ_CST);
+        __atomic_fetch_sub(&self->grp->queued, 1, __ATOMIC_SEQ_CST);
+    }
+    return got;
+}
+
+/**
+ * Take the oldest work item from any other worker's deque in our group,
+ * starting with the next worker along so that thieves spread themselves out.
+ */
+bool stealWork(worker_s *self, work_s *item)
+{
+    group_s *g  = self->grp;
+    deque_s *dq = NULL;
+    bool     got = false;
+    int      i = 0;
+
+    for ( i = 1 ; i < g->num && ! got ; ++i ) {
+        dq = &pool.w[g->first + (self->id - g->first + i) % g->num].dq;
+
+        pthread_mutex_lock(&dq->lock);
+        if ( dq->tail > dq->head ) {
+            *item = dq->items[(dq->head)++];
+            if ( dq->tail == dq->head ) dq->head = dq->tail = 0;
+            got = true;
+        }
+        pthread_mutex_unlock(&dq->lock);
+    }
+
+    if ( got ) {
+        __atomic_fetch_sub(&pool.queued, 1, __ATOMIC_SEQ_CST);
+        __atomic_fetch_sub(&g->queued, 1, __ATOMIC_SEQ_CST);
+    }
+    return got;
+}
+
+/**
+ * Thread body for a pool worker: drain our own deque, then steal, then sleep
+ * until something is queued or every directory has been read.
+ */
+void *poolWorker(void *arg)
+{
+    work_s   item;
+    uint64_t counts[DT_SLOTS];
+    sizes_s  sz;
+
+    self  = (worker_s *)arg;
+    tally = &self->tally;
+    arena = &self->arena;
+    top   = &self->top;
+
+    if ( opt.dbuf > 0 ) {
+        dent_buf   = malloc(opt.dbuf);
+        dent_types = malloc(opt.dbuf / DENT_REC_MIN + 1);
+        if ( ! dent_buf || ! dent_types ) {
+            logError(true, "unable to allocate dirent buffer");
+        }
+    }
+
+    for ( ;; ) {
+        if ( popWork(self, &item) || stealWork(self, &item) ) {
+            cur_root  = item.root;
+            cur_depth = item.depth;
+            if ( item.batch ) {
+                memset(counts, 0, sizeof(counts));
+                memset(&sz, 0, sizeof(sz));
+                resolveList(item.fd, NULL, item.name, item.batch, counts, &sz,
+                            pushWork);
+                addTypes(counts);
+                if ( opt.size || opt.age ) addSizes(&sz);
+                (void)close(item.fd);
+            } else {
+                scanDir(item.fd, item.name, pushWork);
+            }
+            free(item.name);
+
+            if ( __atomic_sub_fetch(&item.root->pending, 1,
+                                    __ATOMIC_ACQ_REL) == 0 ) {
+                clock_gettime(CLOCK_MONOTONIC, &item.root->stop);
+            }
+            if ( __atomic_sub_fetch(&pool.pending, 1, __ATOMIC_SEQ_CST) == 0 ) {
+                wakeAll();
+            }
+            continue;
+        }
+
+        /// Announce ourselves before looking again, so that a push between
+        /// the look and the wait cannot go unsignalled.
+        pthread_mutex_lock(&pool.lock);
+        __atomic_fetch_add(&self->grp->sleepers, 1, __ATOMIC_SEQ_CST);
+        while ( __atomic_load_n(&self->grp->queued, __ATOMIC_SEQ_CST) == 0
+                && __atomic_load_n(&pool.pending, __ATOMIC_SEQ_CST) > 0 ) {
+            pthread_cond_wait(&self->grp->wake, &pool.lock);
+        }
+        __atomic_fetch_sub(&self->grp->sleepers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&pool.lock);
 
-    if ( fail || ! opt.log ) {
-        Dprint("%s", msg_buffer);
-        printf("%s", msg_buffer);
-        free(msg_buffer);
-        exit(errno);
+        if ( __atomic_load_n(&pool.pending, __ATOMIC_SEQ_CST) == 0 ) break;
     }
-}
 
+    flushRows();
+    free(row_buf);
+    free(dent_buf);
+    free(dent_types);
+    statDone();
+    arenaFree(arena);
+    return NULL;
+}
 
 /**
- * Initialise the linked-list for storing directory paths.
+ * Build the workers and their groups for the roots in `paths`. Without
+ * `--per-device-jobs`, `opt.jobs` workers form a single group. With it,
+ * every device holding a root gets a group of `opt.pdj` workers of its own,
+ * so a JBOD of 24 disks is read 24 ways at once while no one disk ever has
+ * more than `opt.pdj` threads seeking across it.
  */
-dir_list_s *createDirList()
+void initPool(dir_list_s *paths)
 {
-    dir_list_s *dir_path = (dir_list_s *)calloc(1, sizeof(dir_list_s));
+    dir_node_s *cursor = NULL;
+    bool        lists = false;
+    int         i = 0, cap_w = 0;
+
+    /// One slot per root is more than enough groups, bar those kept for
+    /// the devices of roots yet to be read from lists.
+    for ( cursor = paths->root ;
+          cursor < paths->root + paths->num_dirs ; ++cursor ) {
+        lists |= cursor->from != NULL;
+    }
+    pool.g = calloc(opt.pdj ? paths->num_dirs + ( lists ? LIST_GROUPS : 0 )
+                            : 1, sizeof(group_s));
+    if ( ! pool.g ) logError(true, "unable to allocate thread pool");
+
+    for ( cursor = paths->root ;
+          cursor < paths->root + paths->num_dirs ; ++cursor ) {
+        for ( i = 0 ; i < pool.num_g ; ++i ) {
+            if ( ! opt.pdj || pool.g[i].dev == cursor->dev ) break;
+        }
+        if ( i == pool.num_g ) {
+            pool.g[i].dev = cursor->dev;
+            pool.g[i].num = opt.pdj ? opt.pdj : opt.jobs;
+            pthread_cond_init(&pool.g[i].wake, NULL);
+            ++pool.num_g;
+        }
+        cursor->grp = &pool.g[i];
+    }
 
-    if ( dir_path ) {
-        Dprint("initialised %s", "dir_path");
-        return dir_path;
-    } else {
-        Dprint("error %d", errno);
-        logError(true, "unable to allocate directory path list");
-        return NULL;
+    for ( i = 0 ; i < pool.num_g ; ++i ) {
+        pool.g[i].first = pool.num;
+        pool.num += pool.g[i].num;
+    }
+    pool.cap_g = pool.num_g + ( opt.pdj && lists ? LIST_GROUPS : 0 );
+    cap_w      = pool.num + ( pool.cap_g - pool.num_g ) * opt.pdj;
+    Dprint("%d workers in %d groups", pool.num, pool.num_g);
+
+    /// Tallies must sit on their own cache lines, which `calloc()` does not
+    /// promise.
+    if ( posix_memalign((void **)&pool.w, CACHE_LINE,
+                        cap_w * sizeof(worker_s)) != 0 ) {
+        logError(true, "unable to allocate thread pool");
     }
+    memset(pool.w, 0, cap_w * sizeof(worker_s));
+    pool.fd_max = raiseFdLimit() / 2;
+
+    for ( i = 0 ; i < pool.num_g ; ++i ) initWorkers(&pool.g[i]);
 }
 
 /**
- * Initialise a list node to the linked-list for storing directory paths.
+ * Set up the workers of group `g`, from `g->first` on, and point them at it.
  */
-dir_node_s *createDirNode(dp_name *dir)
+void initWorkers(group_s *g)
 {
-    dir_node_s *new_ent = (dir_node_s *)calloc(1,sizeof(dir_node_s));
+    int i = 0;
 
-    if ( new_ent ) {
-        new_ent->dir = dir;
-        Dprint("%s", dir);
-        return new_ent;
-    } else {
-        Dprint("error %d", errno);
-        logError(true, "unable to allocate directory entry");
-        return NULL;
+    for ( i = g->first ; i < g->first + g->num ; ++i ) {
+        pool.w[i].id  = i;
+        pool.w[i].grp = g;
+        pthread_mutex_init(&pool.w[i].dq.lock, NULL);
     }
 }
 
 /**
- * Check nodes on linked-list for uniqueness.
+ * The group to scan a `--from-file` root on device `dev` with. The first
+ * root seen on a device no group scans yet gets a new group of `opt.pdj`
+ * workers, started there and then, while `pool.cap_g` allows; past that,
+ * `dflt`. Only the thread reading the lists adds groups, and `wakeAll()`
+ * only sees one once it is complete.
  */
-void checkUniqueDirs(dir_list_s *dir_list)
+group_s *deviceGroup(dev_t dev, group_s *dflt)
 {
-    dir_node_s *cursor = dir_list->head;
-    char          *msg = malloc(MAXPATHLEN + 24);
-    int       i = 0, j = 0;
+    group_s *g = NULL;
+    int      i = 0;
 
-    for ( i = 0 ; i < dir_list->num_dirs ; ++i ) {
-        opt.list[i] = cursor->dir;
-        Dprint("opt.list[%d]: %s", i, opt.list[i]);
-        cursor = cursor->next;
+    for ( i = 0 ; i < pool.num_g ; ++i ) {
+        if ( pool.g[i].dev == dev ) return &pool.g[i];
     }
-
-    for ( i = 0 ; i < dir_list->num_dirs ; ++i ) {
-        for ( j = i + 1 ; j < dir_list->num_dirs ; ++j ) {
-            if ( strncmp(opt.list[i], opt.list[j], MAXPATHLEN) == 0 ) {
-                asprintf(&msg, "%s: directory not unique", opt.list[i]);
-                Dprint("%s==%s: %s", opt.list[i], opt.list[j], msg);
-                logError(true, msg);
-            }
+    if ( pool.num_g == pool.cap_g ) return dflt;
+
+    g        = &pool.g[pool.num_g];
+    g->dev   = dev;
+    g->first = pool.num;
+    g->num   = opt.pdj;
+    pthread_cond_init(&g->wake, NULL);
+    initWorkers(g);
+    __atomic_store_n(&pool.num_g, pool.num_g + 1, __ATOMIC_RELEASE);
+
+    for ( i = g->first ; i < g->first + g->num ; ++i ) {
+        if ( pthread_create(&pool.w[i].tid, NULL, poolWorker, &pool.w[i]) ) {
+            logError(true, "unable to start scanning thread");
         }
     }
-
-    free(msg);
+    pool.num += g->num;
+    Dprint("device %#llx: %d workers", (unsigned long long)dev, g->num);
+    return g;
 }
 
 /**
- * Test directory, identified by pointer to const char, prior to further action.
+ * Scan the trees under every root with the pool's workers. Each root is
+ * dealt to the next worker of its group in turn, so separate roots
+ * (typically separate devices) are read side by side from the start, and
+ * idle workers then steal into whichever trees are largest. Returns once
+ * every tree has been read; with `-C`, prints a snapshot of the running
+ * totals every `UPD_MSEC` until then.
  */
-bool testDir(char *dir)
+void poolScan(dir_list_s *paths)
 {
-    struct stat sb;
-    char *fc = NULL;
+    struct timespec tick = {UPD_MSEC / 1000, (UPD_MSEC % 1000) * 1000000L};
+    dir_node_s *cursor = paths->root;
+    dir_node_s *end    = paths->root + paths->num_dirs;
+    group_s    *g = NULL;
+    uint64_t    values[DT_SLOTS];
+    int         i = 0, fd = -1;
+
+    if ( ! pool.w ) initPool(paths);
+
+    /// Hold one pending directory of our own while the roots are being
+    /// queued, so that no worker decides the scan is over before it starts.
+    __atomic_fetch_add(&pool.pending, 1, __ATOMIC_SEQ_CST);
+
+    for ( i = 0 ; i < pool.num ; ++i ) {
+        if ( pthread_create(&pool.w[i].tid, NULL, poolWorker, &pool.w[i]) ) {
+            logError(true, "unable to start scanning thread");
+        }
+    }
 
-    asprintf(&fc, "%c", dir[0]);
+    for ( ; cursor < end ; ++cursor ) {
+        if ( cursor->from ) continue;
 
-    if ( stat(dir,&sb) == 0 && S_ISDIR(sb.st_mode) ) {
-        if ( strncmp(fc, DFS, 1) == 0 ) {
-            /// Push any legitimate, fully-qualified directory path to a
-            /// holding element to be pushed to linked-list.
-            de.fqdp = dir;
-            Dprint("user: %s", de.fqdp);
-        } else {
-            /// Fully-qualify any legitimate, relative directory path and
-            /// push to holding element.
-            chdir(dir);
-            de.fqdp = getwd((char *)dir);
-            Dprint("FQP: %s", de.fqdp);
+        /// As in `scanList()`, read a root inline rather than queue one more
+        /// descriptor past the open-file limit.
+        if ( __atomic_load_n(&pool.queued, __ATOMIC_RELAXED) >= pool.fd_max ) {
+            getDirStats(cursor);
+            continue;
         }
 
-        ++de.num_dir;
-        Dprint("%s %d", "TRUE", de.num_dir);
-        return true;
+        if ( ( fd = openRoot(cursor) ) < 0 ) continue;
+        g = cursor->grp;
+        clock_gettime(CLOCK_MONOTONIC, &cursor->start);
+        queueWork(&pool.w[g->first + g->next++ % g->num], fd, cursor->dir,
+                  cursor, 0);
     }
 
-    free(fc);
+    /// Lists are read last, as the workers get on with everything else.
+    for ( cursor = paths->root ; cursor < end ; ++cursor ) {
+        if ( ! cursor->from ) continue;
+        clock_gettime(CLOCK_MONOTONIC, &cursor->start);
 
-    /// If neither of the above conditions holds, `*dir` is not a valid
-    /// directory path.
-    Dprint("%s: %s", dir, "FALSE");
-    return false;
-}
+        /// Hold the list open until it is read, like any other directory.
+        __atomic_fetch_add(&cursor->pending, 1, __ATOMIC_RELAXED);
+        scanList(cursor);
+        if ( __atomic_sub_fetch(&cursor->pending, 1, __ATOMIC_ACQ_REL) == 0 ) {
+            clock_gettime(CLOCK_MONOTONIC, &cursor->stop);
+        }
+    }
 
-/**
- * Add a directory entry to the linked-list.
- */
-void addDir(dir_list_s *paths, dir_node_s *dir_node, char *path_arg)
-{
-    if ( testDir(path_arg) ) {
-        Dprint("%s", "testDir returned TRUE to addDir");
-        dir_node = createDirNode(de.fqdp);
-        Dprint("addDir %s", dir_node->dir);
-        dir_node_s *next = paths->head;
-        paths->head = dir_node;
-        dir_node->next = next;
-        ++(paths->num_dirs);
-        Dprint("num_dirs: %d", paths->num_dirs);
-    } else {
-        if ( errno == 0 ) errno = ENOENT;
-        logError(false, path_arg);
+    if ( __atomic_sub_fetch(&pool.pending, 1, __ATOMIC_SEQ_CST) == 0 ) {
+        wakeAll();
     }
-}
 
-/**
- * Add the stats from a node entry (directory path) to the linked-list.
- */
-void getDirStats(dir_node_s *dir_node)
-{
-    Dprint("%s", dir_node->dir);
-    DIR *dp;
-    dp = opendir(dir_node->dir);
-    struct dirent *ep = readdir(dp); // from sys/dirent.h
-
-    if ( dp ) {
-        // Duff's Device?
-        while ( (ep = readdir(dp)) ) {
-            Dprint("ep = %hhu", ep->d_type);
-            switch(ep->d_type) {
-            case DT_BLK:  ++(de.d_blk);
-                Dprint("DT_BLK: %d", de.d_blk);  break;
-            case DT_CHR:  ++(de.d_chr);
-                Dprint("DT_CHR: %d", de.d_chr);  break;
-            case DT_DIR:  ++(de.d_dir);
-                Dprint("DT_DIR: %d", de.d_dir);  break;
-            case DT_LNK:  ++(de.d_lnk);
-                Dprint("DT_LNK: %d", de.d_lnk);  break;
-            case DT_REG:  ++(de.d_reg);
-                Dprint("DT_REG: %d", de.d_reg);  break;
-            case DT_WHT:  ++(de.d_wht);
-                Dprint("DT_WHT: %d", de.d_wht);  break;
-            case DT_FIFO: ++(de.d_fif);
-                Dprint("DT_FIFO: %d", de.d_fif); break;
-            case DT_SOCK: ++(de.d_sok);
-                Dprint("DT_SOCK: %d", de.d_sok); break;
-            default:      ++(de.d_unk);
-                Dprint("DT_UNK: %d", de.d_unk);  break;
-            }
-        }
-    } else {
-        Dprint("error %d", errno);
-        logError(false, dir_node->dir);
+    /// The caller prints the final totals, so only snapshot while busy.
+    while ( opt.upd ) {
+        nanosleep(&tick, NULL);
+        if ( ! __atomic_load_n(&pool.pending, __ATOMIC_SEQ_CST) ) break;
+        getValues(values);
+        printRow(values);
     }
 
-    (void)closedir(dp);
+    for ( i = 0 ; i < pool.num ; ++i ) {
+        pthread_join(pool.w[i].tid, NULL);
+    }
 }
 
 /**
- * Get a list of the directory path entries in the linked-list.
+ * Get a list of the directory path entries in the root table.
  */
 void getAllStats(dir_list_s *paths)
 {
-    dir_node_s *cursor = paths->head;
+    uint64_t i = 0;
+
+    if ( opt.jobs > 1 || opt.pdj > 0 ) {
+        poolScan(paths);
+        return;
+    }
 
-    while ( cursor ) {
-        getDirStats(cursor);
-        cursor = cursor->next;
+    for ( i = 0 ; i < paths->num_dirs ; ++i ) {
+        getDirStats(&paths->root[i]);
     }
 }
 
 /**
- * Populate a `list[]` with the directories to be output.
+ * Add the list of directories to the output buffer.
  * `fmt` action specifies whether to:
- *       + `csv`: Print CSV format to `STDOUT`.
- *       + `reg`: Print "regular" format to `STDOUT`.
- *       + `non`: Write the list of directories to `de.list[]`.
+ *       + `csv`: Use CSV format.
+ *       + `reg`: Use "regular" format.
  */
 void getDirList(dir_list_s *paths, enum action fmt)
 {
-    dir_node_s *cursor = paths->head;
-    char            *c = malloc(sizeof(char));
-    int              i = 0;
+    uint64_t i = 0;
 
     if ( fmt == csv ) {
-        printf("Director%s\n", pl(&paths->num_dirs, c, rep));
+        putOut("Director%s\n", pl(&paths->num_dirs, NULL, rep));
     } else if ( fmt == reg ) {
-        printf("Director%s:\n", pl(&paths->num_dirs, c, rep));
+        putOut("Director%s:\n", pl(&paths->num_dirs, NULL, rep));
+    } else {
+        errno = EINVAL;
+        logError(true, "fmt: incorrect parameter usage");
     }
 
-    while ( cursor ) {
-        if ( fmt == reg ) {
-            printf("\t%s\n", cursor->dir);
-        } else if ( fmt == csv ) {
-            printf("%s\n", cursor->dir);
-        } else if ( fmt == non ) {
-            opt.list[i] = cursor->dir;
-            ++i;
-        } else {
-            errno = EINVAL;
-            logError(true, "fmt: incorrect parameter usage");
-        }
-        cursor = cursor->next;
+    for ( i = 0 ; i < paths->num_dirs ; ++i ) {
+        putOut(( fmt == csv ) ? "%s\n" : "\t%s\n", paths->root[i].dir);
     }
 }
 
 /**
  * Decides whether to add an "s"/"ies" to indicate singular or plural on output
- * strings. Takes an `int` of how many things in question and a pointer to
+ * strings. Takes a `uint64_t` of how many things in question and a pointer to
  * `char` where the appropriate character(s) will be populated or nulled.
  */
-char *pl(int *cnt, char *p, enum action act)
+char *pl(uint64_t *cnt, char *p, enum action act)
 {
-    switch( *(cnt) ) {
-    case 1:
+    if ( *(cnt) == 1 ) {
         if ( act == add ) p = "";
         if ( act == rep ) p = "y";
-        break;
-    default:
+    } else {
         if ( act == add ) p = "s";
         if ( act == rep ) p = "ies";
-        break;
     }
 
     return p;
 }
 
+/**
+ * Add the `--histogram` tables to the output buffer from the totals last
+ * merged: directories by entries, from the smallest bucket used to the
+ * largest, and with `--histogram-depth`, by depth down to the deepest
+ * reached. Each is under a heading unless in quiet-mode, as a `csv` table
+ * with the bounds of each bucket or in the `reg` format of the totals. Both
+ * are left out when no directory was scanned.
+ */
+void histOutput(enum action act)
+{
+    uint64_t lo = 0, hi = 0;
+    int       i = 0, first = 0, last = 0;
+
+    for ( first = 0 ; first < HIST_FAN - 1 && ! de.fan[first] ; ++first ) ;
+    for ( last = HIST_FAN - 1 ; last > first && ! de.fan[last] ; --last ) ;
+
+    /// No directory was scanned, so there is no bucket to bound either table.
+    if ( ! de.fan[first] ) return;
+
+    if ( ! opt.qit ) {
+        putOut(act == csv ? "Min Entries,Max Entries,Directories\n"
+                          : "\nDirectories by entries:\n");
+    }
+    for ( i = first ; i <= last ; ++i ) {
+        lo = i ? 1ULL << (i - 1) : 0;
+        hi = i == HIST_FAN - 1 ? UINT64_MAX : ( i ? ( 1ULL << i ) - 1 : 0 );
+        if ( act == csv ) {
+            putOut("%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n", lo, hi, de.fan[i]);
+        } else if ( lo == hi ) {
+            putOut("%*" PRIu64 ":%" PRIu64 " entr%s\n", de.col_w, de.fan[i],
+                   lo, lo == 1 ? "y" : "ies");
+        } else {
+            putOut("%*" PRIu64 ":%" PRIu64 "-%" PRIu64 " entries\n",
+                   de.col_w, de.fan[i], lo, hi);
+        }
+    }
+
+    if ( ! opt.hdep ) return;
+
+    for ( last = HIST_DEPTH - 1 ; last > 0 && ! de.depth[last] ; --last ) ;
+
+    if ( ! opt.qit ) {
+        putOut(act == csv ? "Depth,Directories\n"
+                          : "\nDirectories by depth:\n");
+    }
+    for ( i = 0 ; i <= last ; ++i ) {
+        if ( act == csv ) {
+            putOut("%d%s,%" PRIu64 "\n", i, i == HIST_DEPTH - 1 ? "+" : "",
+                   de.depth[i]);
+        } else {
+            putOut("%*" PRIu64 ":depth %d%s\n", de.col_w, de.depth[i], i,
+                   i == HIST_DEPTH - 1 ? "+" : "");
+        }
+    }
+}
+
+/**
+ * Add the `--top` list to the output buffer, under a heading unless in
+ * quiet-mode: as a `csv` table of entries and path, or in the `reg` format
+ * of the totals before it.
+ */
+void topOutput(enum action act)
+{
+    arena_mark_s mark = arenaMark(arena);
+    char        *buf  = NULL;
+    size_t       i    = 0;
+
+    mergeTops();
+
+    if ( act == csv ) {
+        if ( ! opt.qit ) putOut("Entries,Path\n");
+        for ( i = 0 ; i < main_top.num ; ++i ) {
+            buf = arenaAlloc(arena, 2 * strlen(main_top.ents[i].path) + 3, 1);
+            csvPath(buf, main_top.ents[i].path);
+            putOut("%" PRIu64 ",%s\n", main_top.ents[i].ents, buf);
+        }
+    } else {
+        if ( ! opt.qit ) putOut("\nLargest directories (entries):\n");
+        for ( i = 0 ; i < main_top.num ; ++i ) {
+            putOut("%*" PRIu64 " %s\n", de.col_w, main_top.ents[i].ents,
+                   main_top.ents[i].path);
+        }
+    }
+
+    arenaRelease(arena, mark);
+}
+
 /**
  * Reads the number of input directories, a pointer to the list of
  * directories, and the directory entry statistics structure and
@@ -410,48 +2945,46 @@ char *pl(int *cnt, char *p, enum action act)
  */
 void blockOutput(dir_list_s *paths, enum action act)
 {
-    char *b = malloc((MAXPATHLEN * paths->num_dirs) + 1024);
-    char *c = malloc(sizeof(char));
-    int   i = 0;
+    uint64_t i = 0;
+    uint64_t values[DT_SLOTS], bytes[DT_SLOTS], alloc[DT_SLOTS];
+
+    getValues(values);
+    growCols(values);
 
     if ( ! opt.qit ) {
-        getDirList(paths, non);
-        asprintf(&b, "Director%s:\n", pl(&paths->num_dirs, c, rep));
-
-        for ( i = 0 ; i < paths->num_dirs ; ++i ) {
-            asprintf(&b, "%s\t%s\n", b, opt.list[i]);
-        }
-
-        asprintf(&b, "%s\nTotals:\n", b);
-    }
-
-    asprintf(&b, "%s%8d:director%s\n",               b, de.d_dir,
-             pl(&de.d_dir, c, rep));
-    asprintf(&b, "%s%8d:FIFO file%s\n",              b, de.d_fif,
-             pl(&de.d_fif, c, add));
-    asprintf(&b, "%s%8d:character special file%s\n", b, de.d_chr,
-             pl(&de.d_chr, c, add));
-    asprintf(&b, "%s%8d:block special file%s\n",     b, de.d_blk,
-             pl(&de.d_blk, c, add));
-    asprintf(&b, "%s%8d:regular file%s\n",           b, de.d_reg,
-             pl(&de.d_reg, c, add));
-    asprintf(&b, "%s%8d:symlink%s\n",                b, de.d_lnk,
-             pl(&de.d_lnk, c, add));
-    asprintf(&b, "%s%8d:socket%s\n",                 b, de.d_sok,
-             pl(&de.d_sok, c, add));
-    asprintf(&b, "%s%8d:union whiteout file%s\n",    b, de.d_wht,
-             pl(&de.d_wht, c, add));
-    asprintf(&b, "%s%8d:unknown file type%s\n",      b, de.d_unk,
-             pl(&de.d_unk, c, add));
-
-    if ( act == wrt ) {
-        writeOut(b);
-    } else {
-        printf("%s", b);
+        getDirList(paths, reg);
+        putOut("\nTotals:\n");
+    }
+
+    for ( i = 0 ; i < (uint64_t)de.num_hdr ; ++i ) {
+        putOut("%*" PRIu64 ":%s%s\n", de.col_w, values[i],
+               DT_TYPES[i].blk, pl(&values[i], NULL, DT_TYPES[i].plu));
+    }
+
+    if ( opt.size ) {
+        getSizes(bytes, alloc);
+        if ( ! opt.qit ) putOut("\nSizes (apparent, allocated bytes):\n");
+        for ( i = 0 ; i < (uint64_t)de.num_hdr ; ++i ) {
+            putOut("%*" PRIu64 " %*" PRIu64 ":%s%s\n", de.col_w, bytes[i],
+                   de.col_w, alloc[i], DT_TYPES[i].blk,
+                   pl(&values[i], NULL, DT_TYPES[i].plu));
+        }
+    }
+
+    if ( opt.age ) {
+        if ( ! opt.qit ) {
+            putOut("\nAges (entries, apparent bytes; last modified):\n");
+        }
+        for ( i = 0 ; i < AGE_SLOTS ; ++i ) {
+            putOut("%*" PRIu64 " %*" PRIu64 ":%s\n", de.col_w, de.ages[i],
+                   de.col_w, de.age_bytes[i], AGE_BLK[i]);
+        }
     }
 
-    free(b);
-    free(c);
+    if ( opt.hist ) histOutput(reg);
+    if ( opt.top )  topOutput(reg);
+
+    writeOut(act);
 }
 
 /**
@@ -461,39 +2994,91 @@ void blockOutput(dir_list_s *paths, enum action act)
  */
 void csvOutput(dir_list_s *paths, enum action act)
 {
-    int          i = 0;
-    int   values[] = {de.d_reg, de.d_dir, de.d_lnk, de.d_blk, de.d_chr,
-                      de.d_fif, de.d_sok, de.d_wht, de.d_unk};
-    char        *c = malloc(sizeof(char));
-    char *csv_list = malloc(sizeof(STAT_CSV) + 1024);
+    uint64_t     i = 0;
+    uint64_t values[DT_SLOTS], bytes[DT_SLOTS], alloc[DT_SLOTS];
 
-    /// Add directory list and header if not in quiet-mode.
+    getValues(values);
+    getSizes(bytes, alloc);
+
+    /// Add directory list and header if not in quiet-mode. With `--sizes`,
+    /// each type's bytes and then its allocated bytes follow the counts;
+    /// with `--ages`, the entries in each age bucket and then their bytes.
     if ( ! opt.qit ) {
-        getDirList(paths, non);
-        asprintf(&csv_list, "Director%s\n", pl(&paths->num_dirs, c, rep));
-        for ( i = 0 ; i < paths->num_dirs ; ++i ) {
-            asprintf(&csv_list, "%s%s\n", csv_list, opt.list[i]);
+        getDirList(paths, csv);
+        for ( i = 0 ; i < (uint64_t)de.num_hdr ; ++i ) {
+            putOut("%s%s", i ? "," : "", DT_TYPES[i].csv);
         }
-
-        for ( i = 0 ; i < de.num_hdr ; ++i ) {
-            asprintf(&csv_list, "%s%s,", csv_list, STAT_CSV[i]);
+        for ( i = 0 ; opt.size && i < (uint64_t)de.num_hdr ; ++i ) {
+            putOut(",%s Bytes", DT_TYPES[i].csv);
+        }
+        for ( i = 0 ; opt.size && i < (uint64_t)de.num_hdr ; ++i ) {
+            putOut(",%s Allocated", DT_TYPES[i].csv);
+        }
+        for ( i = 0 ; opt.age && i < AGE_SLOTS ; ++i ) {
+            putOut(",Modified %s", AGE_CSV[i]);
+        }
+        for ( i = 0 ; opt.age && i < AGE_SLOTS ; ++i ) {
+            putOut(",Modified %s Bytes", AGE_CSV[i]);
         }
-        asprintf(&csv_list, "%s\b \n", csv_list); /// Remove trailing comma.
+        putOut("\n");
     }
 
-    /// Push the corresponding values to the memory block.
-    for ( i = 0 ; i < de.num_hdr ; ++i ) {
-        asprintf(&csv_list, "%s%d,", csv_list, values[i]);
+    /// Push the corresponding values to the output buffer.
+    for ( i = 0 ; i < (uint64_t)de.num_hdr ; ++i ) {
+        putOut("%s%" PRIu64, i ? "," : "", values[i]);
+    }
+    for ( i = 0 ; opt.size && i < (uint64_t)de.num_hdr ; ++i ) {
+        putOut(",%" PRIu64, bytes[i]);
+    }
+    for ( i = 0 ; opt.size && i < (uint64_t)de.num_hdr ; ++i ) {
+        putOut(",%" PRIu64, alloc[i]);
+    }
+    for ( i = 0 ; opt.age && i < AGE_SLOTS ; ++i ) {
+        putOut(",%" PRIu64, de.ages[i]);
     }
-    asprintf(&csv_list, "%s\b \n", csv_list); /// Remove trailing comma.
+    for ( i = 0 ; opt.age && i < AGE_SLOTS ; ++i ) {
+        putOut(",%" PRIu64, de.age_bytes[i]);
+    }
+    putOut("\n");
 
-    if ( act == wrt ) {
-        writeOut(csv_list);
-    } else {
-        printf("%s", csv_list);
+    if ( opt.hist ) histOutput(csv);
+    if ( opt.top )  topOutput(csv);
+
+    writeOut(act);
+}
+
+/**
+ * Widen the count columns to fit the largest of `values[]`, returning `true`
+ * if they grew. Columns never shrink, so continuous output stays aligned
+ * once a count has rolled over into another digit.
+ */
+bool growCols(uint64_t *values)
+{
+    int w = numWidth(values, de.num_col);
+
+    if ( w <= de.col_w ) return false;
+
+    de.col_w = w;
+    return true;
+}
+
+/**
+ * Return the number of digits in the largest of the `n` `values[]`.
+ */
+int numWidth(const uint64_t *values, int n)
+{
+    int      i = 0, w = 1;
+    uint64_t v = 0;
+
+    for ( i = 0 ; i < n ; ++i ) {
+        if ( values[i] > v ) v = values[i];
+    }
+    while ( v >= 10 ) {
+        v /= 10;
+        ++w;
     }
 
-    free(csv_list);
+    return w;
 }
 
 /**
@@ -503,74 +3088,231 @@ void printDeco()
 {
     int i = 0, j = 0;
 
-    for ( i = 0 ; i < de.num_hdr ; ++i ) {
-        printf("+");
-        for ( j = 0 ; j < de.num_hdr ; ++j ) {
-            printf("-");
+    for ( i = 0 ; i < de.num_col ; ++i ) {
+        putOut("+");
+        for ( j = 0 ; j <= de.col_w ; ++j ) {
+            putOut("-");
         }
     }
-    printf("+\n");
+    putOut("+\n");
+}
+
+/**
+ * Print the decorated column header line for linear output.
+ */
+void printHeader()
+{
+    int i = 0;
+
+    printDeco();
+    putOut("|");
+
+    for ( i = 0 ; i < de.num_col ; ++i ) {
+        putOut("%*s |", de.col_w, ( i < de.num_hdr ) ? DT_TYPES[i].hdr
+                                  : SIZE_HDR[i - de.num_hdr]);
+    }
+
+    putOut("\n");
+    printDeco();
+}
+
+/**
+ * Print one row of counts for continuous output: in place, or on a line of
+ * its own with `-L`. The header is re-printed over any wider columns.
+ */
+void printRow(uint64_t *values)
+{
+    int i = 0;
+
+    if ( growCols(values) && ! opt.qit ) {
+        if ( ! opt.lin ) putOut("\n");
+        printHeader();
+    }
+
+    putOut(opt.lin ? "|" : "\r|");
+    for ( i = 0 ; i < de.num_col ; ++i ) {
+        putOut("%*" PRIu64 " |", de.col_w, values[i]);
+    }
+    if ( opt.lin ) putOut("\n");
+    writeOut(prt);
 }
+
 /**
  * Displays output in a linear, continuous, and/or CSV format.
  */
 void lineOutput(dir_list_s *paths, enum action act)
 {
     int i        = 0;
-    int values[] = {de.d_reg, de.d_dir, de.d_lnk, de.d_blk, de.d_chr,
-                    de.d_fif, de.d_sok, de.d_wht, de.d_unk};
+    uint64_t values[DT_SLOTS];
+
+    getValues(values);
+    if ( act != cnt ) growCols(values);
 
     /// Print decoration if not in quiet-mode.
     if ( ! opt.qit ) {
         getDirList(paths, reg);
-
-        printDeco();
-        printf("|");
-
-        for ( i = 0 ; i < de.num_hdr ; ++i ) {
-            printf("%8s |", STAT_HDR[i]);
-        }
-
-        printf("\n");
-        printDeco();
+        printHeader();
     }
 
-    if ( act == cnt ) {
-        dir_node_s *cursor = paths->head;
-        i = 0;
+    /// Show the header before the scan starts.
+    if ( act == cnt ) writeOut(prt);
 
-        while ( cursor ) {
-            getDirStats(cursor);
-            int values[] = {de.d_reg, de.d_dir, de.d_lnk,
-                            de.d_blk, de.d_chr, de.d_fif,
-                            de.d_sok, de.d_wht, de.d_unk};
-            if ( opt.lin ) {
-                printf("|");
-                for ( i = 0 ; i < de.num_hdr ; ++i ) {
-                    printf("%8d |", values[i]);
-                }
-                printf("\n");
-            } else {
-                printf("\r|");
-                for ( i = 0 ; i < de.num_hdr ; ++i ) {
-                    printf("%8d |", values[i]);
-                }
-            }
+    if ( act == cnt && ( opt.jobs > 1 || opt.pdj > 0 ) ) {
+        /// Every root is read at once, with snapshots along the way.
+        getAllStats(paths);
+        getValues(values);
+        printRow(values);
+    } else if ( act == cnt ) {
+        dir_node_s *cursor = paths->root;
 
-            ++i;
-            cursor = cursor->next;
+        for ( ; cursor < paths->root + paths->num_dirs ; ++cursor ) {
+            getDirStats(cursor);
+            getValues(values);
+            printRow(values);
         }
     } else {
         /// Print the values with decoration.
-        printf("|");
-        for ( i = 0 ; i < de.num_hdr ; ++i ) {
-            printf("%8d |", values[i]);
+        putOut("|");
+        for ( i = 0 ; i < de.num_col ; ++i ) {
+            putOut("%*" PRIu64 " |", de.col_w, values[i]);
         }
     }
 
     /// Clean up output decorations.
-    if ( ( opt.upd && ! opt.lin ) || ( opt.lin && ! opt.upd ) ) printf("\n");
+    if ( ( opt.upd && ! opt.lin ) || ( opt.lin && ! opt.upd ) ) putOut("\n");
     if ( ! opt.qit ) printDeco();
+    if ( opt.hist ) histOutput(reg);
+    if ( opt.top )  topOutput(reg);
+
+    writeOut(prt);
+}
+
+/**
+ * Parse a byte count with an optional K, M or G suffix (powers of 1024, with
+ * or without a trailing "B" or "iB"). Sets `errno` to `EINVAL` on junk, and
+ * to `ERANGE` on a count too big for a `size_t`.
+ */
+size_t parseSize(const char *arg)
+{
+    char  *end = NULL;
+    size_t val = 0, mult = 1;
+
+    if ( ! arg || *arg < '0' || *arg > '9' ) {
+        errno = EINVAL;
+        return 0;
+    }
+
+    val = (size_t)strtoull(arg, &end, 10);
+
+    switch ( *end ) {
+    case 'G': case 'g': mult <<= 10; // fall through
+    case 'M': case 'm': mult <<= 10; // fall through
+    case 'K': case 'k': mult <<= 10; ++end; break;
+    }
+
+    if ( val > SIZE_MAX / mult ) {
+        errno = ERANGE;
+        return 0;
+    }
+    val *= mult;
+
+    if ( *end != '\0' && strcmp(end, "B") != 0 && strcmp(end, "iB") != 0 ) {
+        errno = EINVAL;
+        return 0;
+    }
+
+    return val;
+}
+
+/**
+ * Print the `--stats` summary to `STDERR`, so that it can be compared across
+ * readers and buffer sizes without disturbing the regular output.
+ */
+void printScanStats(dir_list_s *paths)
+{
+    dir_node_s *cursor = paths->root;
+    double secs = (double)(ss.stop.tv_sec - ss.start.tv_sec)
+                  + (double)(ss.stop.tv_nsec - ss.start.tv_nsec) / 1e9;
+    arena_s *a = NULL;
+    uint64_t allocs = 0, chunks = 0;
+    size_t   peak = 0;
+    int      w = 0;
+
+    mergeTallies();
+
+    fprintf(stderr, "\nScan statistics:\n");
+    if ( opt.dbuf > 0 ) {
+        fprintf(stderr, "%16s: getdents64, %zu-byte buffer, %s histogram\n",
+                "reader", opt.dbuf, hist_name);
+    } else {
+        fprintf(stderr, "%16s: readdir\n", "reader");
+    }
+    fprintf(stderr, "%16s: %" PRIu64 "\n", "directories", ss.dirs);
+    fprintf(stderr, "%16s: %" PRIu64 "\n", "entries", ss.ents);
+    if ( opt.dbuf > 0 ) {
+        fprintf(stderr, "%16s: %" PRIu64 " (%.6f per entry)\n",
+                "getdents64 calls",
+                ss.reads, ss.ents ? (double)ss.reads / ss.ents : 0.0);
+    }
+    if ( opt.unk || opt.size || opt.age ) {
+        fprintf(stderr, "%16s: %" PRIu64 " entries, ", "lookups", ss.looks);
+        if ( opt.sq > 0 && ! uring_err ) {
+            fprintf(stderr, "io_uring, %u in flight\n", opt.sq);
+        } else {
+            fprintf(stderr, "%s%s%s\n",
+#ifdef __linux__
+                    "statx",
+#else
+                    "fstatat",
+#endif
+                    uring_err ? ", io_uring: " : "",
+                    uring_err ? strerror(uring_err) : "");
+        }
+    }
+    if ( opt.uniq ) {
+        fprintf(stderr, "%16s: %" PRIu64 " unique, %" PRIu64 " repeated, "
+                "%zu bytes\n", "inode set", inoCount(),
+                __atomic_load_n(&inos.dups, __ATOMIC_RELAXED), inoBytes());
+    }
+    /// Every thread's peak is added up, as if they had all come at once.
+    for ( w = -1 ; w < pool.num ; ++w ) {
+        a = ( w < 0 ) ? &main_arena : &pool.w[w].arena;
+        allocs += a->allocs;
+        chunks += a->chunks;
+        peak   += a->peak;
+    }
+    fprintf(stderr, "%16s: %" PRIu64 " allocations, %" PRIu64 " chunks, "
+            "%zu bytes at peak\n", "arenas", allocs, chunks, peak);
+    fprintf(stderr, "%16s: %.6f\n", "seconds", secs);
+    fprintf(stderr, "%16s: %.0f\n", "entries/sec",
+            secs > 0 ? (double)ss.ents / secs : 0.0);
+
+    /// How long each root took, which shows up any slow devices.
+    for ( ; cursor < paths->root + paths->num_dirs ; ++cursor ) {
+        if ( cursor->outer ) {
+            fprintf(stderr, "%16s: %s: inside %s\n", "root", cursor->dir,
+                    cursor->outer->dir);
+            continue;
+        }
+        fprintf(stderr, "%16s: %s: %" PRIu64 " directories, %" PRIu64
+                " entries, %.6f seconds\n", "root", cursor->dir,
+                cursor->tally.dirs, cursor->tally.ents,
+                (double)(cursor->stop.tv_sec - cursor->start.tv_sec)
+                + (double)(cursor->stop.tv_nsec - cursor->start.tv_nsec)
+                  / 1e9);
+    }
+
+    /// How evenly the work was shared out.
+    for ( w = 0 ; w < pool.num ; ++w ) {
+        fprintf(stderr, "%13s %2d: %" PRIu64 " directories, %" PRIu64
+                " entries", "thread", w, pool.w[w].tally.dirs,
+                pool.w[w].tally.ents);
+        if ( opt.pdj ) {
+            fprintf(stderr, ", device %#llx",
+                    (unsigned long long)pool.w[w].grp->dev);
+        }
+        fprintf(stderr, "\n");
+    }
 }
 
 /**
@@ -610,10 +3352,16 @@ int displayOutput(dir_list_s *paths)
 int main(int argc, char *argv[])
 {
     /// Initialise any starting variables not set at compile-time.
-    de.num_hdr = sizeof(STAT_HDR) / sizeof(STAT_HDR[0]);
+    de.num_hdr = sizeof(DT_TYPES) / sizeof(DT_TYPES[0]);
+    for ( int i = 0 ; i < de.num_hdr ; ++i ) {
+        if ( (int)strlen(DT_TYPES[i].hdr) > de.col_w ) {
+            de.col_w = strlen(DT_TYPES[i].hdr);
+        }
+    }
 
     /// Initialise, read, and set the various user options.
     int param_index = 0;
+    char       *end = NULL;
     cag_option_context context;
 
     cag_option_init(&context, options, CAG_ARRAY_SIZE(options), argc, argv);
@@ -632,6 +3380,94 @@ int main(int argc, char *argv[])
         case 'q':
             opt.qit = true;
             break;
+        case 'r':
+            opt.rec = true;
+            break;
+        case 'j':
+            opt.jobs = cag_option_get_value(&context)
+                       ? (int)strtol(cag_option_get_value(&context), &end, 10)
+                       : -1;
+            if ( opt.jobs == 0 ) opt.jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+            if ( opt.jobs < 1 || *end != '\0' ) {
+                errno = EINVAL;
+                logError(true, "-j/--jobs must supply a valid N");
+            }
+            break;
+        case 'D':
+            opt.pdj = cag_option_get_value(&context)
+                      ? (int)strtol(cag_option_get_value(&context), &end, 10)
+                      : -1;
+            if ( opt.pdj < 1 || *end != '\0' ) {
+                errno = EINVAL;
+                logError(true, "--per-device-jobs must supply a valid N");
+            }
+            break;
+        case 'U':
+            opt.uniq = true;
+            break;
+        case 'R':
+            opt.unk = true;
+            break;
+        case 'z':
+            opt.size = true;
+            break;
+        case 'A':
+            opt.age = true;
+            break;
+        case 'P':
+            opt.pdir = true;
+            break;
+        case 'H':
+            opt.hist = true;
+            break;
+        case 'e':
+            opt.hist = opt.hdep = true;
+            break;
+        case 'T':
+            opt.top = cag_option_get_value(&context)
+                      ? (size_t)strtoull(cag_option_get_value(&context), &end,
+                                         10)
+                      : 0;
+            if ( opt.top < 1 || *end != '\0' ) {
+                errno = EINVAL;
+                logError(true, "--top must supply a valid N");
+            }
+            break;
+        case 'Q':
+            opt.sq = cag_option_get_value(&context)
+                     ? (unsigned)strtoul(cag_option_get_value(&context), &end,
+                                         10)
+                     : STAT_QUEUE_MAX + 1;
+            if ( opt.sq > STAT_QUEUE_MAX || *end != '\0' ) {
+                errno = EINVAL;
+                logError(true, "--stat-queue must supply a valid N");
+            }
+#ifndef HAVE_URING
+            opt.sq = 0; /// io_uring is Linux-only.
+#endif
+            break;
+        case 'B':
+            errno = 0;
+            opt.dbuf = parseSize(cag_option_get_value(&context));
+            if ( errno || ( opt.dbuf > 0 && opt.dbuf < DENT_BUF_MIN )
+                 || opt.dbuf > DENT_BUF_MAX ) {
+                errno = EINVAL;
+                logError(true, "--dirent-buffer must supply a valid SIZE");
+            }
+#ifndef __linux__
+            opt.dbuf = 0; /// `getdents64()` is Linux-only.
+#endif
+            break;
+        case 'S':
+            opt.sts = true;
+            break;
+        case 'F':
+            if ( opt.from || ! cag_option_get_value(&context) ) {
+                errno = EINVAL;
+                logError(true, "--from-file must supply a single FILE");
+            }
+            opt.from = (char *)cag_option_get_value(&context);
+            break;
         case 'o':
             opt.out = true;
             if ( cag_option_get_value(&context) ) {
@@ -652,7 +3488,7 @@ int main(int argc, char *argv[])
                 opt.logfile = (char *)cag_option_get_value(&context);
                 opt.LOGFILE = fopen(opt.logfile, opt.FILEOPTS);
                 if ( ! opt.LOGFILE ) {
-                    Dprint("*opt.logfile: %i", opt.LOGFILE->_file);
+                    Dprint("NULL FILE *opt.logfile: %s", opt.logfile);
                     logError(true, opt.logfile);
                 }
             } else {
@@ -681,51 +3517,101 @@ int main(int argc, char *argv[])
         }
     }
 
-    /// Initialise the variables and linked list for storing directory paths.
-    dp_name    *dir_path = NULL;
-    dir_node_s *dir_node = NULL;
-    dir_list_s *dir_list = createDirList();
-    char       *safe_dir = malloc(MAXPATHLEN);
+    /// Line output gains the two `--sizes` totals as extra columns.
+    de.num_col = de.num_hdr + ( opt.size ? 2 : 0 );
+
+    /// Initialise the variables and root table for storing directory paths,
+    /// with a slot for every argument, a `--from-file` list and the current
+    /// working directory.
+    dir_list_s *dir_list = createDirList(argc - cag_option_get_index(&context)
+                                         + 2);
     int          dir_cnt = 0;
 
+    /// Roots may hold a quarter of the descriptors; the pool takes half.
+    de.fd_max = raiseFdLimit() / 4;
+
     /// Loop over all non-option arguments (directory paths or junk data)
-    /// and add valid paths to the linked-list.
+    /// and add valid paths to the root table, in order.
     for ( param_index = cag_option_get_index(&context) ;
           param_index < argc ; ++param_index ) {
         Dprint("loop: %02d: param_index = %d, dir_cnt = %d",
                dir_cnt, param_index, dir_cnt);
-        asprintf(&safe_dir, "%s", argv[param_index]); /// safe string handling
-        if ( strcmp(CD, safe_dir) == 0 ) {
-            getcwd(safe_dir, sizeof(argv[param_index]));
-        }
-        addDir(dir_list, dir_node, safe_dir);
+        addDir(dir_list, argv[param_index]);
+        ++dir_cnt;
+    }
+
+    if ( opt.from ) {
+        addList(dir_list, opt.from);
         ++dir_cnt;
     }
 
     /// If no directory paths were supplied from the command line,
-    /// add the current working directory to the linked-list.
+    /// add the current working directory to the root table.
     Dprint("dir_cnt: %d", dir_cnt);
     if ( dir_cnt == 0 ) {
-        addDir(dir_list, dir_node, getcwd(dir_path, MAXPATHLEN));
+        addDir(dir_list, (char *)CD);
         ++dir_cnt;
     }
 
     if ( de.num_dir != dir_list->num_dirs ) {
-        Dprint("dir_cnt: %d, de.num_dir: %d, dir_list->num_dirs: %d",
+        Dprint("dir_cnt: %d, de.num_dir: %" PRIu64 ", num_dirs: %" PRIu64,
                dir_cnt, de.num_dir, dir_list->num_dirs);
         errno = EIO;
         logError(true, "directory count mismatch");
-    } else if ( ( dir_cnt == 1 ) && ( opt.upd ) ) {
+    } else if ( ( dir_cnt == 1 ) && ( opt.upd ) && ( ! opt.from ) ) {
         errno = EINVAL;
         logError(true, "continuous update requires multiple directories");
+    } else if ( opt.upd && opt.pdir ) {
+        errno = EINVAL;
+        logError(true, "--per-dir cannot be combined with continuous update");
     }
 
     if ( dir_cnt > 1 ) checkUniqueDirs(dir_list);
+    if ( dir_cnt > 1 && opt.rec ) checkNestedDirs(dir_list);
+
+    /// Unless told otherwise, give each root a thread of its own; a list
+    /// could hold any number of them.
+    if ( opt.jobs == 0 && opt.from ) {
+        opt.jobs = ROOT_JOBS_MAX;
+    } else if ( opt.jobs == 0 ) {
+        opt.jobs = dir_list->num_dirs < ROOT_JOBS_MAX
+                   ? (int)dir_list->num_dirs : ROOT_JOBS_MAX;
+    }
+
+    if ( opt.dbuf > 0 ) {
+        dent_buf   = malloc(opt.dbuf);
+        dent_types = malloc(opt.dbuf / DENT_REC_MIN + 1);
+        if ( ! dent_buf || ! dent_types ) {
+            logError(true, "unable to allocate dirent buffer");
+        }
+        pickHist();
+    }
+
+    if ( opt.uniq ) initInoSet();
+
+    /// `--per-dir` rows stream out during the scan, ahead of the totals.
+    if ( opt.pdir && ! opt.qit ) {
+        rowHeader(prt);
+        if ( opt.out ) rowHeader(wrt);
+    }
+
+    if ( opt.age ) age_now = time(NULL);
+    clock_gettime(CLOCK_MONOTONIC, &ss.start);
     if ( !   opt.upd ) getAllStats(dir_list);
+    if ( !   opt.upd ) clock_gettime(CLOCK_MONOTONIC, &ss.stop);
+    if ( opt.pdir ) flushRows();
 
     displayOutput(dir_list);
 
+    if (     opt.upd ) clock_gettime(CLOCK_MONOTONIC, &ss.stop);
+    if (     opt.sts ) printScanStats(dir_list);
+
     if ( opt.out ) fclose(opt.OUTFILE);
     if ( opt.log ) fclose(opt.LOGFILE);
+    statDone();
+    free(row_buf);
+    for ( size_t i = 0 ; i < main_top.num ; ++i ) free(main_top.ents[i].path);
+    free(main_top.ents);
+    arenaFree(&main_arena);
     exit(errno);
 }
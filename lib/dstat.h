@@ -31,21 +31,46 @@
 /* OTHER DEALINGS IN THE SOFTWARE.                                       */
 /*************************************************************************/
 
+/**
+ * glibc hides `asprintf()`, `O_NOATIME` and friends behind `_GNU_SOURCE`,
+ * which must be set before the first system header is pulled in.
+ */
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
 /**
  * All the libraries that are fit to print.
  * Note non-standard github.com:likle/cargs.git
  */
 #include <cargs.h>
 #include <stdbool.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/errno.h>
+#include <sys/param.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/resource.h>
 #include <dirent.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 /**
  * Define this as the DStat header file. For when only the most verbose
@@ -64,7 +89,81 @@
  * For some reason, we can figure out the system-specific, but not the generic,
  * MAXPATHLEN.
  */
+#ifdef __DARWIN_MAXPATHLEN
+#undef  MAXPATHLEN
 #define MAXPATHLEN __DARWIN_MAXPATHLEN
+#endif
+
+/**
+ * Default, minimum and maximum `--dirent-buffer` sizes. The kernel refuses a
+ * buffer that cannot hold a single maximal record, so anything under a page
+ * is rejected outright, and takes its size as an `unsigned int`, so nothing
+ * near 4GiB is allowed either; the default trades 1MiB of memory for roughly
+ * one `getdents64()` call per 30,000 entries on typical file names.
+ */
+#ifdef __linux__
+#define DENT_BUF_DFLT (1024 * 1024)
+#else
+#define DENT_BUF_DFLT 0
+#endif
+#define DENT_BUF_MIN  4096
+#define DENT_BUF_MAX  (1024 * 1024 * 1024)
+
+/**
+ * `O_NOATIME` spares the inode write that reading a directory would cost,
+ * but is Linux-only.
+ */
+#ifndef O_NOATIME
+#define O_NOATIME 0
+#endif
+
+/**
+ * The smallest record `getdents64()` can return: the fixed 19-byte header
+ * plus a one-character name and its NUL, padded to 8 bytes. Sizes the
+ * `d_type` gather array so that it can never overflow a full buffer.
+ */
+#define DENT_REC_MIN  24
+
+/**
+ * Entries to look up, with `--resolve-unknown`, `--sizes` or `--ages`, are
+ * handed on in batches of this many names while their directory is read, so
+ * the list of them never grows with the directory. A pool worker queues each
+ * batch for others to steal, so one huge directory is stat'ed by every
+ * thread in its group as it is read.
+ */
+#define RESOLVE_BATCH 1024
+
+/**
+ * Map an `st_mode` to its `d_type`, for platforms that lack the macro.
+ */
+#ifndef IFTODT
+#define IFTODT(mode) (((mode) & 0170000) >> 12)
+#endif
+
+/**
+ * With `--stat-queue`, batches of lookups go through an io_uring where the
+ * kernel headers know `IORING_OP_STATX`. That is an enum, so cannot be
+ * tested for; Linux 5.6 added `IORING_FEAT_CUR_PERSONALITY` alongside it,
+ * which is a macro. The ring is off by default: the kernel hands every
+ * `statx()` request to a worker thread of its own, which costs more than
+ * the call itself wherever the inode is cached or on local disk.
+ */
+#ifdef IORING_FEAT_CUR_PERSONALITY
+#define HAVE_URING
+#endif
+#define STAT_QUEUE_DFLT 0
+#define STAT_QUEUE_MAX  4096
+
+/**
+ * How often, in milliseconds, `-C` refreshes the running totals while a
+ * `-j` pool is still scanning.
+ */
+#define UPD_MSEC 500
+
+/**
+ * Without `-j`, each root gets a thread of its own, up to this many.
+ */
+#define ROOT_JOBS_MAX 64
 
 /**
  * Set up debug printing.
@@ -87,35 +186,167 @@
 void logError(bool fail, char *msg);
 
 /**
- * Function to write to output opt.outfile if specified.
+ * `d_type` is a four-bit field (see `IFTODT()`), so every value the kernel
+ * can hand back indexes directly into an array of this many counters.
  */
-void writeOut(char *msg);
+#define DT_SLOTS 16
 
 /**
- * The nominal list of file types available from dirent.h entries that will
- * be displayed, in a sensible order. This, along with `dir_ent_s{}`, below,
- * should be updated to match your target OS/filesystem dirent.h.
+ * `--histogram` buckets: directories holding no entries, then one bucket
+ * per power of two, the last holding up to `UINT64_MAX` of them; and depths
+ * below a root, the last holding every level from there down.
  */
-char *STAT_HDR[] = {"Regular", "Dir", "Link", "Block", "Char",
-                    "FIFO", "Socket", "WhtOut", "Unknown"};
+#define HIST_FAN   65
+#define HIST_DEPTH 64
+
+/**
+ * `--ages` buckets, by time since an entry was last modified: under each of
+ * `AGE_LIMIT[]` seconds (a day, a week, 30 days and a year), then older.
+ */
+#define AGE_SLOTS 5
 
-/// Same as above but with names fully written out for CSV output.
-char *STAT_CSV[] = {"Regular", "Directory", "Link", "Block Special",
-                    "Character Special", "FIFO", "Socket", "White Out",
-                    "Unknown"};
 /**
  * This structure holds the variables and pointers for adding dirent.h
  * statistical entries. Additional parameters are supported.
  */
 struct dir_ent_s {
-    int  d_fif, d_chr, d_dir, d_blk, d_reg, d_lnk, d_sok, d_wht, d_unk;
+    uint64_t counts[DT_SLOTS]; /// Entries seen, indexed directly by `d_type`.
+    uint64_t bytes[DT_SLOTS];  /// With `--sizes`, their apparent bytes,
+    uint64_t alloc[DT_SLOTS];  /// and the bytes allocated to them.
+    uint64_t fan[HIST_FAN];     /// With `--histogram`, directories by entries,
+    uint64_t depth[HIST_DEPTH]; /// and by depth below a root, if asked.
+    uint64_t ages[AGE_SLOTS];   /// With `--ages`, entries by age,
+    uint64_t age_bytes[AGE_SLOTS]; /// and their apparent bytes.
     int  num_hdr; /// Number of dirent.h file types.
-    int  num_dir; /// Number of `testDir()` == TRUE directories.
+    int  num_col; /// Columns of line output: the types, then any totals.
+    int  col_w;   /// Width of a count column; only ever grows.
+    uint64_t num_dir; /// Number of `testDir()` == TRUE directories.
     char *fqdp;   /// Fully-qualified directory path string for passing to
                   /// the `struct dir_node{}`.
+    dev_t fqdev;  /// Device holding `fqdp`, likewise.
+    ino_t fqino;  /// Inode of `fqdp`, likewise.
+    int   fqfd;   /// Descriptor held open on `fqdp`, or -1, likewise.
+    uint64_t num_fd; /// Roots held open by `testDir()`.
+    uint64_t fd_max; /// Cap on `num_fd`, leaving the rest for scanning.
 
 };
 
+/**
+ * Counters updated by different threads are kept this far apart so that no
+ * two ever share a cache line. 128 bytes covers Apple silicon's lines and
+ * the adjacent-line prefetch of recent Intel parts as well as 64-byte lines.
+ */
+#define CACHE_LINE 128
+
+/**
+ * One thread's running totals. Only its own thread ever writes to a tally;
+ * `mergeTallies()` reads them all into `de` and `ss` at report time.
+ */
+typedef struct {
+    uint64_t counts[DT_SLOTS]; /// entries seen, indexed by `d_type`
+    uint64_t ents;             /// directory entries examined
+    uint64_t dirs;             /// directories read
+    uint64_t reads;            /// `getdents64()` calls
+    uint64_t looks;            /// entries looked up by `statBatch()`
+    uint64_t bytes[DT_SLOTS];  /// with `--sizes`, apparent bytes by `d_type`
+    uint64_t alloc[DT_SLOTS];  /// and bytes allocated, likewise
+    uint64_t fan[HIST_FAN];     /// with `--histogram`, see `addHist()`
+    uint64_t depth[HIST_DEPTH];
+    uint64_t ages[AGE_SLOTS];   /// with `--ages`, entries by age
+    uint64_t age_bytes[AGE_SLOTS]; /// and their apparent bytes
+} __attribute__((aligned(CACHE_LINE))) tally_s;
+
+/**
+ * A root's own totals, for `--stats`. Every worker scanning under the root
+ * adds to them, so they too are kept on a cache line of their own.
+ */
+typedef struct {
+    uint64_t ents; /// directory entries examined
+    uint64_t dirs; /// directories read
+} __attribute__((aligned(CACHE_LINE))) root_tally_s;
+
+/// One directory in a `--top` list.
+typedef struct {
+    uint64_t ents; /// entries counted in it
+    char     *path;
+} top_ent_s;
+
+/**
+ * One thread's `--top` list: a min-heap of at most `opt.top` directories,
+ * so that the one with the fewest entries, next to be displaced, is always
+ * at `ents[0]`. It grows as needed, so a large N costs nothing up front.
+ */
+typedef struct {
+    top_ent_s *ents;
+    size_t     num;
+    size_t     cap;
+} top_s;
+
+/**
+ * Running totals describing the scan itself rather than what was found,
+ * printed to `STDERR` by `--stats`.
+ */
+struct scan_sts_s {
+    uint64_t        ents;  /// directory entries examined
+    uint64_t        dirs;  /// directories read
+    uint64_t        reads; /// `getdents64()` calls (Linux reader only)
+    uint64_t        looks; /// entries looked up by `statBatch()`
+    struct timespec start; /// when scanning began
+    struct timespec stop;  /// when scanning finished
+};
+
+/**
+ * Bump allocator. Paths, list nodes and other records that live as long as
+ * the run are carved out of the main thread's arena and freed in one shot at
+ * exit. Each scanning thread has an arena of its own for the records of the
+ * directory being read, handed back with `arenaRelease()` once it is done;
+ * directories are finished in the reverse order that they are started on
+ * any one thread, so the arena behaves as a stack. Queued work and `--top`
+ * paths outlive that order, so they still come from `malloc()`.
+ */
+#define ARENA_CHUNK (64 * 1024) /// default chunk size in bytes
+
+typedef struct arena_chunk_s {
+    struct arena_chunk_s *prev;
+    size_t               size;    /// bytes in `data[]`
+    size_t               used;    /// bytes of `data[]` handed out
+    char                 data[] __attribute__((aligned(16)));
+} arena_chunk_s;
+
+typedef struct {
+    arena_chunk_s *head;   /// chunk being carved up
+    arena_chunk_s *spare;  /// a released chunk kept for reuse
+    uint64_t      allocs;  /// allocations made
+    uint64_t      chunks;  /// chunks taken from `malloc()`
+    size_t        bytes;   /// bytes handed out and not yet released
+    size_t        peak;    /// the most `bytes` has ever been
+} arena_s;
+
+/// A point to roll an arena back to.
+typedef struct {
+    arena_chunk_s *chunk;
+    size_t        used;
+    size_t        bytes;
+} arena_mark_s;
+
+/// Carve `n` bytes aligned to `align`, a power of two, out of arena `a`.
+void *arenaAlloc(arena_s *a, size_t n, size_t align);
+
+/// Resize `p` of `old` bytes to `n`, in place if it was the last carved.
+void *arenaGrow(arena_s *a, void *p, size_t old, size_t n);
+
+/// Copy string `s` into arena `a`.
+char *arenaStrdup(arena_s *a, const char *s);
+
+/// Note the current top of arena `a`.
+arena_mark_s arenaMark(arena_s *a);
+
+/// Hand back everything carved out of arena `a` since mark `m`.
+void arenaRelease(arena_s *a, arena_mark_s m);
+
+/// Free every chunk of arena `a`, keeping its statistics.
+void arenaFree(arena_s *a);
+
 /**
  * Separate structure for passing selected options to functions.
  */
@@ -126,51 +357,457 @@ struct sel_opts_s {
     bool qit;       /// quite mode; no header lines on line output
     bool out;       /// send output to a file
     bool log;       /// send errors to a log file
+    bool rec;       /// descend recursively through sub-directories
+    bool sts;       /// print scan statistics to `STDERR` on completion
+    bool uniq;      /// count each (device, inode) once; see `inoInsert()`
+    bool unk;       /// resolve `DT_UNKNOWN` entries; see `resolveList()`
+    bool size;      /// total apparent and allocated bytes by type
+    bool pdir;      /// stream a row per directory read; see `putRow()`
+    bool hist;      /// histogram of entries per directory; see `addHist()`
+    bool hdep;      /// and of directories by depth, `--histogram-depth`
+    bool age;       /// count entries and bytes by age; see `ageSlot()`
+    unsigned sq;    /// io_uring depth for `statBatch()`; 0 for plain calls
+    size_t top;     /// directories to list by entries; see `keepTop()`
+    size_t dbuf;    /// `getdents64()` buffer size in bytes; 0 uses `readdir()`
+    int  jobs;      /// number of scanning threads; 0 for one per root
+    int  pdj;       /// scanning threads per device; 0 to share them all
+    char *from;     /// `--from-file` list of roots; "-" for `STDIN`
     char *outfile;  /// name of output file
     char *logfile;  /// name of log file
     FILE *OUTFILE;  /// file descriptor for output file
     FILE *LOGFILE;  /// file descriptor for log file
     char *FILEOPTS; /// placeholder for file handling options
-    char *list[];   /// placeholder for massaging a directory list
 };
 
 /**
- * The following structs and function declarations enable the linked-list
- * for adding and traversing directory paths.
+ * The following structs and function declarations make up the root table:
+ * one flat array of the directories to scan, in the order given, which the
+ * scanners and the output formatters alike walk from start to end.
  */
 /// Special type specific to directory path names.
 typedef char dp_name;
 
-/// A directory entry node on the linked-list.
+/// A root in the table, with the totals for the tree under it kept apart from
+/// every other root's. Its tally keeps each entry on cache lines of its own.
 typedef struct dir_node_s {
-    struct dir_node_s *next;
+    root_tally_s      tally;   /// this root's own totals
     dp_name           *dir;
+    dev_t             dev;     /// device the root lives on
+    ino_t             ino;     /// inode of the root itself
+    int               fd;      /// held open from validation on, or -1
+    struct dir_node_s *outer;  /// with `-r`, a root this one lies inside
+    FILE              *from;   /// `--from-file` list to stream roots from
+    struct group_s    *grp;    /// workers scanning this root's device
+    uint64_t          pending; /// directories under this root not yet read
+    struct timespec   start;   /// when this root was queued
+    struct timespec   stop;    /// when its last directory was read
 } dir_node_s;
 
-/// The linked-list itself.
+/// The root table itself.
 typedef struct {
-    dir_node_s *head;
-    int        num_dirs;
+    dir_node_s *root;     /// `cap` slots, `CACHE_LINE` aligned
+    uint64_t   num_dirs;  /// slots in use
+    uint64_t   cap;
 } dir_list_s;
 
-/// Initialise the linked-list in main().
-dir_list_s *createDirList();
+/// Initialise the root table in main() with room for `cap` roots.
+dir_list_s *createDirList(uint64_t cap);
 
-/// Initialise a node on the linked-list.
-dir_node_s *createDirNode(dp_name *dir);
+/// Initialise the next root in the table.
+dir_node_s *createDirNode(dir_list_s *paths, dp_name *dir);
 
-/// Check nodes on linked-list for uniqueness.
+/// Check roots in the table for uniqueness.
 void checkUniqueDirs(dir_list_s *dir_list);
 
-/// Add a directory entry to the linked-list.
-void addDir(dir_list_s *paths, dir_node_s *dir_node, char *path_arg);
+/**
+ * A component-wise prefix trie of root paths, for `checkNestedDirs()`. Nodes
+ * live in one array and are found through an open-addressing index keyed on
+ * (parent, component), so each step down costs one hash of the component.
+ */
+typedef struct {
+    uint32_t   parent; /// index of the parent node; node 0 is "/"
+    uint32_t   len;    /// length of `name`
+    const char *name;  /// path component, not NUL-terminated
+    dir_node_s *root;  /// root whose path ends here, if any
+} trie_node_s;
+
+typedef struct {
+    trie_node_s *node;
+    uint32_t    num;   /// nodes in use
+    uint32_t    *slot; /// node indices; 0 marks an empty slot
+    size_t      cap;   /// number of slots, a power of two
+} trie_s;
+
+/// Find the child `name` of node `parent`, adding it if `add` is set.
+uint32_t trieStep(trie_s *t, uint32_t parent, const char *name, uint32_t len,
+                  bool add);
+
+/// With `-r`, point each root lying inside another root at the outermost.
+void checkNestedDirs(dir_list_s *dir_list);
 
-/// Traverse the linked-list to populate dir_ent_s{}.
+/// Add a directory entry to the root table.
+void addDir(dir_list_s *paths, char *path_arg);
+
+/// Traverse the root table to populate dir_ent_s{}.
 void getAllStats(dir_list_s *paths);
 
-/// Add the stats from a node entry (directory path) to the linked-list.
+/// Add the `--from-file` list `file` to the root table as one root.
+void addList(dir_list_s *paths, char *file);
+
+/// Read the next newline- or NUL-separated path from a `--from-file` list.
+char *nextRoot(FILE *fp, char **buf, size_t *cap, int *sep);
+
+/// Scan, or queue for the pool, each root read from a `--from-file` node.
+void scanList(dir_node_s *list);
+
+/// Add the stats from a node entry (directory path) in the root table.
 void getDirStats(dir_node_s *dir_node);
 
+/**
+ * Receives each sub-directory found by a reader when `-r` is selected, as a
+ * freshly opened descriptor it takes ownership of and its entry name, or
+ * with `--per-dir` its path.
+ */
+typedef void (*emit_fn)(int fd, char *name);
+
+/// One directory's `--sizes` totals, indexed by `d_type` like its counts,
+/// and its `--ages` totals, by `ageSlot()`.
+typedef struct {
+    uint64_t bytes[DT_SLOTS];      /// apparent bytes
+    uint64_t alloc[DT_SLOTS];      /// bytes allocated
+    uint64_t ages[AGE_SLOTS];      /// entries
+    uint64_t age_bytes[AGE_SLOTS]; /// and their apparent bytes
+} sizes_s;
+
+/// Add the stats from an open directory descriptor, descending with `-r`.
+void getFdStats(int fd, char *name);
+
+/// Read one open directory with the selected reader, passing any
+/// sub-directories to `emit`.
+void scanDir(int fd, char *name, emit_fn emit);
+
+/// Portable reader built on `readdir()`.
+void readDirStats(int fd, char *name, emit_fn emit);
+
+/// Count a single directory entry of the given `d_type` into `counts[]`.
+void addType(uint64_t *counts, unsigned char type);
+
+/// Fold `counts[]` alone into this thread's tally.
+void addTypes(uint64_t *counts);
+
+/// Fold `--sizes` and `--ages` totals into this thread's tally.
+void addSizes(sizes_s *sz);
+
+/// The `--ages` bucket for an entry last modified at `mtime`.
+int ageSlot(int64_t mtime);
+
+/// Fold one directory's worth of counts into this thread's tally.
+void addCounts(uint64_t *counts, uint64_t ents, uint64_t reads);
+
+/// Count one directory, holding `counts[]`, into this thread's histograms.
+void addHist(uint64_t *counts);
+
+/// Append a name to a NUL-separated list in the calling thread's arena.
+void pushName(char **list, size_t *len, size_t *cap, const char *name);
+
+/// With `--per-dir`, the path of entry `sub` of directory `dir`.
+char *subPath(char *dir, char *sub);
+
+/// Look up, count and, with `-r`, descend into a list of entries.
+void resolveList(int fd, char *dir, char *names, size_t len,
+                 uint64_t *counts, sizes_s *sz, emit_fn emit);
+
+/// Look up the listed entries of one directory, sharing big lists out.
+size_t resolveEntries(int fd, char *dir, char *names, size_t len,
+                      uint64_t *counts, sizes_s *sz, emit_fn emit, bool last);
+
+/// Sum every thread's tally into `de` and `ss`.
+void mergeTallies();
+
+/**
+ * The following structs and function declarations make up the stat layer,
+ * for modes that need more of an entry than its `d_type`. A batch of names
+ * is looked up relative to their directory's descriptor. On Linux, each
+ * thread puts its batches through an io_uring of its own, `--stat-queue`
+ * entries deep, which keeps that many `statx()` calls in flight on the
+ * kernel's workers while the thread reaps whichever finish first. Where
+ * there is no ring, or it cannot be set up, each is a plain system call.
+ */
+/// What a lookup found out about one entry.
+typedef struct {
+    unsigned char type;  /// its `d_type`; `DT_UNKNOWN` if it could not be seen
+    ino_t         ino;   /// its inode number
+    uint64_t      size;  /// with `--sizes`, its apparent size in bytes
+    uint64_t      alloc; /// and the bytes allocated to it, `st_blocks * 512`
+    int64_t       mtime; /// with `--ages`, when it was last modified
+    bool          dated; /// whether `mtime` was filled in
+} stat_rec_s;
+
+#ifdef HAVE_URING
+/// One thread's io_uring, mapped from the kernel.
+typedef struct {
+    int                 fd;      /// ring descriptor; -1 if not set up
+    unsigned            depth;   /// submission queue entries
+    unsigned            *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned            *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void                *sq_map, *cq_map;
+    size_t              sq_len, cq_len, sqe_len;
+} uring_s;
+
+/// Set up and map a ring of at least `depth` entries.
+bool uringInit(uring_s *r, unsigned depth);
+
+/// Unmap and close a ring.
+void uringFree(uring_s *r);
+
+/// Look up `n` entries of `fd` with `statx()` requests through ring `r`.
+void uringStat(uring_s *r, int fd, char **names, size_t n, stat_rec_s *recs);
+#endif
+
+/// Look up one entry of `fd` with a plain system call.
+void statEntry(int fd, const char *name, stat_rec_s *rec);
+
+#if defined(__linux__) && defined(STATX_TYPE)
+/// The `statx()` fields the selected modes need.
+unsigned statMask();
+
+/// Copy what `statx()` filled in into a lookup record.
+void statRec(const struct statx *sx, stat_rec_s *rec);
+#endif
+
+/// Look up `n` entries of `fd` by the best means available.
+void statBatch(int fd, char **names, size_t n, stat_rec_s *recs);
+
+/// Release the calling thread's share of the stat layer.
+void statDone();
+
+#ifdef __linux__
+/**
+ * The record layout returned by the raw `getdents64()` system call. glibc
+ * only exports it as `struct dirent64` under `_LARGEFILE64_SOURCE`, so it is
+ * spelled out here as the kernel documents it.
+ */
+struct linux_dirent64 {
+    uint64_t       d_ino;    /// 64-bit inode number
+    int64_t        d_off;    /// 64-bit offset to next structure
+    unsigned short d_reclen; /// size of this dirent
+    unsigned char  d_type;   /// file type
+    char           d_name[]; /// filename (null-terminated)
+};
+
+/// Add the stats from an open directory descriptor via `getdents64()`.
+void getDentStats(int fd, char *name, emit_fn emit);
+#endif
+
+/**
+ * Histogram kernels: add the number of occurrences of each `d_type` value
+ * in `n` gathered type bytes to `counts[DT_SLOTS]`. Every byte must already
+ * be masked below `DT_SLOTS`. `pickHist()` chooses the fastest kernel the
+ * running CPU supports.
+ */
+typedef void (*hist_fn)(const unsigned char *types, size_t n,
+                        uint64_t *counts);
+
+/// Portable kernel, also used for the tail of the vector kernels.
+void histScalar(const unsigned char *types, size_t n, uint64_t *counts);
+
+#if defined(__x86_64__) || defined(__i386__)
+/// 16 entries per step with SSE4.2.
+void histSSE42(const unsigned char *types, size_t n, uint64_t *counts);
+
+/// 32 entries per step with AVX2.
+void histAVX2(const unsigned char *types, size_t n, uint64_t *counts);
+#endif
+
+/// Select the histogram kernel for the running CPU.
+void pickHist();
+
+/**
+ * The following structs and function declarations make up the `-j` thread
+ * pool. Each worker owns a deque of open directories: it pushes and pops
+ * its own discoveries at the tail, depth-first, while idle workers steal
+ * from the head, where the oldest and usually largest subtrees wait.
+ */
+/// One unit of work: an open directory, its entry name, its root and how
+/// far below it it lies. It may instead be a batch of `batch` bytes of
+/// NUL-separated names in `name` to look up relative to `fd`.
+typedef struct {
+    int        fd;
+    char       *name;
+    dir_node_s *root;
+    int        depth;
+    size_t     batch;
+} work_s;
+
+/// A worker's deque, guarded by its own lock.
+typedef struct {
+    pthread_mutex_t lock;
+    work_s          *items;
+    size_t          head, tail, cap;
+} deque_s;
+
+/**
+ * With `--per-device-jobs`, room for this many more groups is kept for the
+ * devices `--from-file` roots turn up on as the lists are read. Roots on any
+ * device past that share their list's own group.
+ */
+#define LIST_GROUPS 128
+
+/**
+ * Workers are split into groups that only ever steal from one another. With
+ * `--per-device-jobs`, there is one group per device holding a root, which
+ * caps the number of threads reading each device; otherwise every worker is
+ * in one group.
+ */
+typedef struct group_s {
+    dev_t           dev;      /// device this group scans
+    int             first;    /// index of the group's first worker
+    int             num;      /// number of workers in the group
+    int             next;     /// worker to be dealt the group's next root
+    uint64_t        queued;   /// directories waiting in the group's deques
+    int             sleepers; /// workers waiting for something to steal
+    pthread_cond_t  wake;
+} group_s;
+
+/// A worker thread, its tally, its deque, its arena and its `--top` list.
+typedef struct {
+    tally_s   tally;
+    arena_s   arena;
+    top_s     top;
+    pthread_t tid;
+    int       id;
+    group_s   *grp;
+    deque_s   dq;
+} worker_s;
+
+/// The pool shared by every worker.
+struct pool_s {
+    worker_s        *w;
+    int             num;      /// number of workers
+    group_s         *g;
+    int             num_g;    /// number of groups
+    int             cap_g;    /// groups there is room for, workers too
+    uint64_t        pending;  /// directories queued or being read
+    uint64_t        queued;   /// directories waiting in a deque, fd held open
+    uint64_t        fd_max;   /// cap on `queued` before descending inline
+    pthread_mutex_t lock;     /// guards every group's `wake`
+};
+
+/// Scan the trees under every root with `opt.jobs` workers.
+void poolScan(dir_list_s *paths);
+
+/// Queue an open directory under `root` on worker `w`'s deque.
+void queueWork(worker_s *w, int fd, char *name, dir_node_s *root,
+               int depth);
+
+/// Queue a batch of entries of `fd` to look up on worker `w`'s deque.
+void queueBatch(worker_s *w, int fd, char *names, size_t len,
+                dir_node_s *root, int depth);
+
+/// Put a work item on worker `w`'s deque and wake a thief for it.
+void queueItem(worker_s *w, work_s item);
+
+/// Build the workers and their groups for the roots in `paths`.
+void initPool(dir_list_s *paths);
+
+/// Set up the workers of group `g` and point them at it.
+void initWorkers(group_s *g);
+
+/// The group for a `--from-file` root on device `dev`, started if new.
+group_s *deviceGroup(dev_t dev, group_s *dflt);
+
+/// Wake every sleeping worker, e.g. once the last directory is read.
+void wakeAll();
+
+/// `emit_fn` for workers: queue a sub-directory on the calling worker.
+void pushWork(int fd, char *name);
+
+/// Open a directory for reading, sparing its access time where allowed.
+int openDir(const char *path);
+
+/// Open a root directory for scanning, or log why not and return -1.
+int openRoot(dir_node_s *dir_node);
+
+/// Open a sub-directory for descent and count it, or return -1.
+int openSub(int fd, char *name, uint64_t *counts);
+
+/// Whether an entry of unknown type is a directory for `-r` to descend into.
+bool isSubDir(int fd, const char *name, unsigned char type);
+
+/// Take the newest work item from the calling worker's own deque.
+bool popWork(worker_s *self, work_s *item);
+
+/// Take the oldest work item from any other worker's deque.
+bool stealWork(worker_s *self, work_s *item);
+
+/// Thread body for a pool worker.
+void *poolWorker(void *arg);
+
+/**
+ * The following structs and function declarations make up the
+ * `--unique-inodes` set: every (device, inode) pair seen so far, so that hard
+ * links, bind mounts and overlapping roots are only counted once. It is split
+ * into shards, each an open-addressing table with its own lock, so threads
+ * seldom wait on one another. A slot costs ten bytes: the inode number, plus
+ * a small index into `ino_set_s.devs` in place of the full `dev_t`.
+ */
+#define INO_SHARDS    256
+#define INO_SHARD_MIN 1024 /// slots each shard starts with; a power of two
+#define INO_DEVS_MAX  4096 /// distinct devices the set can tell apart
+
+/// One shard, grown by doubling once it is 70% full.
+typedef struct {
+    pthread_mutex_t lock;
+    uint64_t        *ino;  /// inode numbers
+    uint16_t        *dev;  /// device index plus one; 0 marks an empty slot
+    size_t          cap;   /// number of slots
+    size_t          used;  /// number of slots filled
+} __attribute__((aligned(CACHE_LINE))) ino_shard_s;
+
+/// The set itself.
+struct ino_set_s {
+    ino_shard_s     shard[INO_SHARDS];
+    dev_t           devs[INO_DEVS_MAX]; /// device behind each index
+    int             num_devs;
+    uint64_t        dups;               /// pairs seen more than once
+    pthread_mutex_t lock;               /// guards adding to `devs`
+};
+
+/// Spread a device index and inode number over 64 bits.
+uint64_t inoHash(uint16_t di, uint64_t ino);
+
+/// Allocate every shard of the set.
+void initInoSet();
+
+/// Return the set's index for `dev`, adding it if need be.
+uint16_t devIndex(dev_t dev);
+
+/// Record inode `ino` on device index `di`, returning true the first time.
+bool inoInsert(uint16_t di, uint64_t ino);
+
+/// Return the set's index for the device holding open directory `fd`.
+uint16_t fdDevIndex(int fd);
+
+/// Check a directory just opened on `fd`: true if it has not been seen.
+bool dirIsNew(int fd, char *name);
+
+/// Bytes held by the set's tables.
+size_t inoBytes();
+
+/// Number of distinct pairs held by the set.
+uint64_t inoCount();
+
+/// Raise the open-file limit as far as allowed and return it.
+rlim_t raiseFdLimit();
+
+/// Parse a byte count with an optional K, M or G suffix.
+size_t parseSize(const char *arg);
+
+/// Print the `--stats` summary to `STDERR`.
+void printScanStats(dir_list_s *paths);
+
 /**
  * The `action` enum is generic for functions needing extra direction.
  */
@@ -187,10 +824,126 @@ enum action {
 
 /**
  * Decides whether to add an "s"/"ies" to indicate singular or plural on output
- * strings. Takes an `int` of how many things in question and a pointer to
+ * strings. Takes a `uint64_t` of how many things in question and a pointer to
  * `char` where the appropriate character(s) will be populated or nulled.
  */
-char *pl(int *cnt, char *c, enum action act);
+char *pl(uint64_t *cnt, char *c, enum action act);
+
+/**
+ * Every formatter appends to one growable output buffer, which is flushed
+ * with a single `write()` and then reused, so output costs linear time and
+ * allocations stop once the buffer is big enough.
+ */
+#define OUT_BUF_MIN 4096
+
+struct out_buf_s {
+    char   *buf;
+    size_t len;   /// bytes waiting to be written
+    size_t cap;   /// bytes allocated
+};
+
+/// Append `printf()`-style output to the output buffer.
+void putOut(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+ * Flush the output buffer to `-o OUTFILE` (`wrt`) or to `STDOUT` (`prt`).
+ */
+void writeOut(enum action act);
+
+/// Write all `len` bytes of `buf` to `fd`, named `what` in any error.
+void writeAll(int fd, const char *buf, size_t len, char *what);
+
+/**
+ * `--per-dir` rows are streamed while the scan runs. Each thread formats its
+ * rows into a buffer of its own, at least this big, which is written out
+ * whole once full, so rows never interleave and memory stays bounded
+ * however many directories there are.
+ */
+#define ROW_BUF 65536
+
+/// Print the `--per-dir` column headings.
+void rowHeader(enum action act);
+
+/// Format one directory's `--per-dir` row into the thread's row buffer.
+void putRow(char *path, uint64_t *counts, sizes_s *sz);
+
+/// Write out and empty the thread's row buffer.
+void flushRows();
+
+/// Write `path` to `dst` quoted for CSV if need be, returning its length.
+size_t csvPath(char *dst, const char *path);
+
+/// Offer the directory at `path`, with `counts[]`, to the thread's `--top`.
+void keepTop(char *path, uint64_t *counts);
+
+/// Add `e` to the `--top` heap `t`, which takes ownership of its path.
+void pushTop(top_s *t, top_ent_s e);
+
+/// Gather every thread's `--top` list into the main thread's, largest first.
+void mergeTops();
+
+/// Add the `--top` list to the output buffer in the format of `act`.
+void topOutput(enum action act);
+
+/// Add the `--histogram` tables to the output buffer in the format of `act`.
+void histOutput(enum action act);
+
+/**
+ * One row per file type reported, shared by every output format.
+ */
+struct dt_type_s {
+    unsigned char type; /// `DT_` value from dirent.h indexing `de.counts[]`
+    char *hdr;          /// short column header for line output
+    char *csv;          /// name fully written out for CSV output
+    char *blk;          /// singular stem for block output
+    enum action plu;    /// how `pl()` pluralises `blk`
+};
+
+/**
+ * The nominal list of file types available from dirent.h entries that will
+ * be displayed, in a sensible order. This should be updated to match your
+ * target OS/filesystem dirent.h; nothing else needs to change to add a type.
+ * Any `d_type` not listed here is reported under `DT_UNKNOWN`.
+ */
+struct dt_type_s DT_TYPES[] = {
+    {DT_REG,     "Regular", "Regular",           "regular file",           add},
+    {DT_DIR,     "Dir",     "Directory",         "director",               rep},
+    {DT_LNK,     "Link",    "Link",              "symlink",                add},
+    {DT_BLK,     "Block",   "Block Special",     "block special file",     add},
+    {DT_CHR,     "Char",    "Character Special", "character special file", add},
+    {DT_FIFO,    "FIFO",    "FIFO",              "FIFO file",              add},
+    {DT_SOCK,    "Socket",  "Socket",            "socket",                 add},
+    {DT_WHT,     "WhtOut",  "White Out",         "union whiteout file",    add},
+    {DT_UNKNOWN, "Unknown", "Unknown",           "unknown file type",      add}
+};
+
+/**
+ * The `--sizes` columns of line output, after the types: total apparent and
+ * allocated bytes.
+ */
+char *SIZE_HDR[] = {"Bytes", "Alloc"};
+
+/**
+ * The `--ages` buckets: the age in seconds each is under, and their names
+ * in CSV headings and in block output.
+ */
+const int64_t AGE_LIMIT[AGE_SLOTS - 1] = {
+    86400, 7 * 86400, 30 * 86400, 365 * 86400
+};
+char *AGE_CSV[AGE_SLOTS] = {"<1d", "<7d", "<30d", "<1y", "Older"};
+char *AGE_BLK[AGE_SLOTS] = {
+    "under a day", "under a week", "under 30 days", "under a year",
+    "a year or more"
+};
+
+/// Gather the merged totals in `DT_TYPES[]` order.
+void getValues(uint64_t *values);
+
+/// Gather the merged `--sizes` totals in `DT_TYPES[]` order.
+void getSizes(uint64_t *bytes, uint64_t *alloc);
+
+/// Sum `slots[]` into `values[]` in `DT_TYPES[]` order.
+void foldSlots(const uint64_t *slots, uint64_t *values);
 
 /**
  * Test directory, identified by pointer to const char, prior to further action.
@@ -210,18 +963,36 @@ void blockOutput(dir_list_s *paths, enum action act);
  */
 void csvOutput(dir_list_s *paths, enum action act);
 
+/// Number of digits in the largest of `n` values.
+int numWidth(const uint64_t *values, int n);
+
+/**
+ * Widen the count columns to fit `values[]`, returning `true` if they grew.
+ */
+bool growCols(uint64_t *values);
+
 /**
  * Print decorations for linear output.
  */
 void printDeco();
 
+/**
+ * Print the decorated column header line for linear output.
+ */
+void printHeader();
+
+/**
+ * Print one row of counts for continuous output.
+ */
+void printRow(uint64_t *values);
+
 /**
  * Displays output in a linear, continuous, and/or CSV format.
  */
 void lineOutput(dir_list_s *paths, enum action act);
 
 /**
- * Populate a `list[]` with the directories to be output.
+ * Add the list of directories to the output buffer.
  */
 void getDirList(dir_list_s *paths, enum action fmt);
 